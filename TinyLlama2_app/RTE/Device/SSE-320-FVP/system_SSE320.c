@@ -104,4 +104,10 @@ void SystemInit (void)
 
     SystemCoreClock = SYSTEM_CLOCK;
     PeripheralClock = PERIPHERAL_CLOCK;
+
+    /* Start the DWT cycle counter here so the application can time its boot,
+       including the copy/zero tables run before main() */
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
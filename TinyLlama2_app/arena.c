@@ -0,0 +1,48 @@
+#include "arena.h"
+#include <stdio.h>
+
+#define ARENA_ROUND_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+void arena_init(Arena* a, const char* name, void* base, size_t size) {
+    // Align the base ourselves in case the backing store is not
+    uintptr_t start = ARENA_ROUND_UP((uintptr_t)base);
+    size_t skip = start - (uintptr_t)base;
+    
+    a->name = name;
+    a->base = (uint8_t*)start;
+    a->size = size > skip ? size - skip : 0;
+    a->used = 0;
+    a->n_entries = 0;
+}
+
+void* arena_alloc(Arena* a, const char* name, size_t bytes) {
+    size_t padded = ARENA_ROUND_UP(bytes);
+    if (padded > a->size - a->used) {
+        printf("Arena %s: %s needs %u bytes, only %u of %u left\r\n", a->name, name,
+               (unsigned)padded, (unsigned)(a->size - a->used), (unsigned)a->size);
+        return NULL;
+    }
+    
+    void* ptr = a->base + a->used;
+    if (a->n_entries < ARENA_MAX_ENTRIES) {
+        ArenaEntry* e = &a->entries[a->n_entries++];
+        e->name = name;
+        e->offset = a->used;
+        e->bytes = bytes;
+    }
+    a->used += padded;
+    return ptr;
+}
+
+size_t arena_remaining(const Arena* a) {
+    return a->size - a->used;
+}
+
+void arena_report(const Arena* a) {
+    printf("Arena %s @ %p: %u / %u bytes used\r\n", a->name, (void*)a->base,
+           (unsigned)a->used, (unsigned)a->size);
+    for (int i = 0; i < a->n_entries; i++) {
+        const ArenaEntry* e = &a->entries[i];
+        printf("  %-12s %8u bytes at +%u\r\n", e->name, (unsigned)e->bytes, (unsigned)e->offset);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bump allocator over one fixed region. Every buffer is aligned to
+// ARENA_ALIGN so Helium loads run full width and no buffer shares a
+// cache line with its neighbour. Allocations are recorded by name for
+// the budget report; there is no free, the arena lives as long as the
+// model.
+
+#define ARENA_ALIGN 32
+#define ARENA_MAX_ENTRIES 16
+
+typedef struct {
+    const char* name;
+    size_t offset;
+    size_t bytes;
+} ArenaEntry;
+
+typedef struct {
+    const char* name;     // region name for the report
+    uint8_t* base;        // ARENA_ALIGN aligned
+    size_t size;          // budget in bytes
+    size_t used;
+    int n_entries;
+    ArenaEntry entries[ARENA_MAX_ENTRIES];
+} Arena;
+
+void arena_init(Arena* a, const char* name, void* base, size_t size);
+
+// Carve an aligned buffer; NULL (and a message) if the budget is exceeded
+void* arena_alloc(Arena* a, const char* name, size_t bytes);
+
+// Bytes still available after alignment padding
+size_t arena_remaining(const Arena* a);
+
+// Print the per-buffer byte breakdown and total against the budget
+void arena_report(const Arena* a);
+
+#endif // ARENA_H
@@ -0,0 +1,46 @@
+#include "boot_time.h"
+#include <stdio.h>
+
+#ifdef __ARM_ARCH
+#include "RTE_Components.h"
+#include CMSIS_device_header
+#define BOOT_CLOCK_HZ SystemCoreClock
+#else
+#include <time.h>
+#define BOOT_CLOCK_HZ CLOCKS_PER_SEC
+#endif
+
+static const char* stage_names[BOOT_MAX_STAGES];
+static uint32_t stage_end[BOOT_MAX_STAGES];
+static int n_stages;
+
+uint32_t boot_cycles(void) {
+#ifdef __ARM_ARCH
+    return DWT->CYCCNT;
+#else
+    return (uint32_t)clock();
+#endif
+}
+
+void boot_mark(const char* stage) {
+    if (n_stages < BOOT_MAX_STAGES) {
+        stage_names[n_stages] = stage;
+        stage_end[n_stages] = boot_cycles();
+        n_stages++;
+    }
+}
+
+unsigned long boot_cycles_to_us(uint32_t cycles) {
+    return (unsigned long)((uint64_t)cycles * 1000000u / BOOT_CLOCK_HZ);
+}
+
+void boot_report(void) {
+    uint32_t prev = 0;
+    printf("Boot time breakdown:\r\n");
+    for (int i = 0; i < n_stages; i++) {
+        uint32_t cycles = stage_end[i] - prev;
+        printf("  %-28s %10lu cycles %8lu us\r\n", stage_names[i], (unsigned long)cycles, boot_cycles_to_us(cycles));
+        prev = stage_end[i];
+    }
+    printf("  %-28s %10lu cycles %8lu us\r\n", "reset to model ready", (unsigned long)prev, boot_cycles_to_us(prev));
+}
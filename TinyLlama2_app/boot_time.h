@@ -0,0 +1,24 @@
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+#include <stdint.h>
+
+// Boot-time breakdown from reset to "model ready". On the target the DWT
+// cycle counter is started in SystemInit(), so the first mark also covers
+// the C runtime startup (copy/zero tables). Host builds use clock().
+
+#define BOOT_MAX_STAGES 12
+
+// Cycles since reset
+uint32_t boot_cycles(void);
+
+// Cycles to microseconds at the core clock
+unsigned long boot_cycles_to_us(uint32_t cycles);
+
+// Close a boot stage; its cost is the time since the previous mark
+void boot_mark(const char* stage);
+
+// Print every stage and the total since reset
+void boot_report(void);
+
+#endif // BOOT_TIME_H
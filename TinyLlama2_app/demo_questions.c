@@ -0,0 +1,33 @@
+#include "demo_questions.h"
+
+#define DEMO_LIST(name, ...) \
+    static const char* const name##_text[] = { __VA_ARGS__ }; \
+    const DemoQuestions name = { name##_text, sizeof(name##_text) / sizeof(name##_text[0]) }
+
+DEMO_LIST(demo_boot_questions,
+    "Hello, what can you tell me about AI?",
+    "What is machine learning?",
+    "How does embedded AI work?",
+    "Tell me about ARM processors");
+
+DEMO_LIST(demo_session_questions,
+    "What is AI?",
+    "How does machine learning work?",
+    "What is embedded AI?",
+    "Tell me about ARM processors",
+    "What is a transformer model?",
+    "Hello, how are you?");
+
+DEMO_LIST(demo_switch_questions,
+    "What is artificial intelligence?",
+    "How does deep learning work?");
+
+DEMO_LIST(demo_loop_questions,
+    "What is deep learning?",
+    "How does computer vision work?",
+    "What can you do?");
+
+const DemoQuestions* const demo_question_lists[] = {
+    &demo_boot_questions, &demo_session_questions, &demo_switch_questions, &demo_loop_questions
+};
+const int demo_question_list_count = sizeof(demo_question_lists) / sizeof(demo_question_lists[0]);
@@ -0,0 +1,21 @@
+#ifndef DEMO_QUESTIONS_H
+#define DEMO_QUESTIONS_H
+
+// Questions the demo in main.c asks, kept in one place so
+// scripts/build_prompt_cache.c tokenizes exactly these at build time
+
+typedef struct {
+    const char* const* questions;
+    int count;
+} DemoQuestions;
+
+extern const DemoQuestions demo_boot_questions;    // welcome and auto-demo, asked once at boot
+extern const DemoQuestions demo_session_questions; // interactive Q&A session, in turn
+extern const DemoQuestions demo_switch_questions;  // simulated switches 0x01, 0x02
+extern const DemoQuestions demo_loop_questions;    // simulation loop
+
+// All of the lists above
+extern const DemoQuestions* const demo_question_lists[];
+extern const int demo_question_list_count;
+
+#endif // DEMO_QUESTIONS_H
@@ -0,0 +1,92 @@
+#include "kv_cache.h"
+#include <stdio.h>
+#include <string.h>
+
+int kv_pool_init(KVPool* pool, void* mem, size_t bytes, int n_layers, int kv_dim) {
+    pool->base = (float*)mem;
+    pool->n_layers = n_layers;
+    pool->kv_dim = kv_dim;
+    pool->block_floats = (size_t)n_layers * 2 * KV_BLOCK_SIZE * kv_dim;
+    
+    size_t n_blocks = bytes / (pool->block_floats * sizeof(float));
+    pool->n_blocks = n_blocks > KV_MAX_BLOCKS ? KV_MAX_BLOCKS : (int)n_blocks;
+    
+    // Free list is a stack; hand out low blocks first
+    pool->n_free = pool->n_blocks;
+    for (int i = 0; i < pool->n_blocks; i++) {
+        pool->free_list[i] = (int16_t)(pool->n_blocks - 1 - i);
+        pool->refcount[i] = 0;
+    }
+    return pool->n_blocks;
+}
+
+void kv_seq_init(KVSequence* seq, KVPool* pool) {
+    seq->pool = pool;
+    seq->n_blocks = 0;
+}
+
+static int block_alloc(KVPool* pool) {
+    if (pool->n_free == 0) {
+        return -1;
+    }
+    int block = pool->free_list[--pool->n_free];
+    pool->refcount[block] = 1;
+    return block;
+}
+
+static void block_release(KVPool* pool, int block) {
+    if (--pool->refcount[block] == 0) {
+        pool->free_list[pool->n_free++] = (int16_t)block;
+    }
+}
+
+int kv_seq_reserve(KVSequence* seq, int pos) {
+    KVPool* pool = seq->pool;
+    int index = pos / KV_BLOCK_SIZE;
+    
+    // Positions are written in order, so at most the next block is new
+    while (seq->n_blocks <= index) {
+        if (seq->n_blocks >= KV_MAX_BLOCKS) {
+            return -1;
+        }
+        int block = block_alloc(pool);
+        if (block < 0) {
+            printf("KV cache pool exhausted (%d blocks)\r\n", pool->n_blocks);
+            return -1;
+        }
+        seq->blocks[seq->n_blocks++] = (int16_t)block;
+    }
+    
+    // Copy-on-write: a block shared with another sequence is copied before
+    // this sequence writes its own positions into it
+    int shared = seq->blocks[index];
+    if (pool->refcount[shared] > 1) {
+        int block = block_alloc(pool);
+        if (block < 0) {
+            printf("KV cache pool exhausted (%d blocks)\r\n", pool->n_blocks);
+            return -1;
+        }
+        memcpy(pool->base + (size_t)block * pool->block_floats,
+               pool->base + (size_t)shared * pool->block_floats,
+               pool->block_floats * sizeof(float));
+        block_release(pool, shared);
+        seq->blocks[index] = (int16_t)block;
+    }
+    return 0;
+}
+
+void kv_seq_fork(KVSequence* dst, const KVSequence* src) {
+    dst->pool = src->pool;
+    dst->n_blocks = src->n_blocks;
+    for (int i = 0; i < src->n_blocks; i++) {
+        dst->blocks[i] = src->blocks[i];
+        src->pool->refcount[src->blocks[i]]++;
+    }
+}
+
+void kv_seq_truncate(KVSequence* seq, int n_pos) {
+    int keep = (n_pos + KV_BLOCK_SIZE - 1) / KV_BLOCK_SIZE;
+    while (seq->n_blocks > keep) {
+        block_release(seq->pool, seq->blocks[--seq->n_blocks]);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef KV_CACHE_H
+#define KV_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Paged KV cache: a shared pool of fixed-size blocks, each holding the keys
+// and values of KV_BLOCK_SIZE consecutive positions for every layer, and a
+// per-sequence block table mapping position / KV_BLOCK_SIZE to a block.
+// Sequences only hold the blocks they have filled, so several of them can
+// share one pool. Blocks are reference counted: kv_seq_fork() shares a
+// prefix and the first write to a shared block copies it.
+
+#ifndef KV_BLOCK_SIZE
+#define KV_BLOCK_SIZE 16          // positions per block
+#endif
+#define KV_MAX_BLOCKS 256         // blocks per pool and per block table
+
+typedef struct KVPool {
+    float* base;
+    int n_blocks;
+    int n_layers;
+    int kv_dim;
+    size_t block_floats;          // n_layers * 2 * KV_BLOCK_SIZE * kv_dim
+    int n_free;
+    int16_t free_list[KV_MAX_BLOCKS];
+    uint8_t refcount[KV_MAX_BLOCKS];
+} KVPool;
+
+typedef struct KVSequence {
+    KVPool* pool;
+    int n_blocks;
+    int16_t blocks[KV_MAX_BLOCKS]; // block table
+} KVSequence;
+
+// Split mem into as many blocks as fit (up to KV_MAX_BLOCKS); returns the block count
+int kv_pool_init(KVPool* pool, void* mem, size_t bytes, int n_layers, int kv_dim);
+
+void kv_seq_init(KVSequence* seq, KVPool* pool);
+
+// Make position pos writable: allocate its block, or copy it if shared.
+// Returns -1 when the pool is out of blocks.
+int kv_seq_reserve(KVSequence* seq, int pos);
+
+// Share all of src's blocks with dst (dst must be empty)
+void kv_seq_fork(KVSequence* dst, const KVSequence* src);
+
+// Drop the blocks past the first n_pos positions (n_pos = 0 releases all)
+void kv_seq_truncate(KVSequence* seq, int n_pos);
+
+// Key / value vector (kv_dim,) of one layer at one position
+static inline float* kv_key(const KVSequence* seq, int layer, int pos) {
+    const KVPool* pool = seq->pool;
+    float* block = pool->base + (size_t)seq->blocks[pos / KV_BLOCK_SIZE] * pool->block_floats;
+    return block + ((size_t)(layer * 2) * KV_BLOCK_SIZE + pos % KV_BLOCK_SIZE) * pool->kv_dim;
+}
+
+static inline float* kv_value(const KVSequence* seq, int layer, int pos) {
+    const KVPool* pool = seq->pool;
+    float* block = pool->base + (size_t)seq->blocks[pos / KV_BLOCK_SIZE] * pool->block_floats;
+    return block + ((size_t)(layer * 2 + 1) * KV_BLOCK_SIZE + pos % KV_BLOCK_SIZE) * pool->kv_dim;
+}
+
+#endif // KV_CACHE_H
@@ -0,0 +1,69 @@
+#include "kv_snapshot.h"
+#include "model_blob.h"
+#include <stdio.h>
+#include <string.h>
+
+uint32_t kv_snapshot_hash(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int kv_snapshot_load(KVSequence* seq, const Config* p, const uint8_t* snapshot, const uint8_t* model,
+                     const int* tokens, int n_tokens) {
+    if (!snapshot) {
+        return -1;
+    }
+    
+    // Only the model header is hashed: it holds the config, every tensor
+    // offset and size and the CRC of the tensor data extract_weights.py
+    // computed, so retrained weights of the same shape change it too
+    // without hashing the whole blob at boot
+    const KVSnapshotHeader* h = (const KVSnapshotHeader*)snapshot;
+    if (h->magic != KV_SNAPSHOT_MAGIC || h->version != KV_SNAPSHOT_VERSION) {
+        printf("Invalid KV snapshot (magic 0x%08lX, version %lu)\r\n",
+               (unsigned long)h->magic, (unsigned long)h->version);
+        return -1;
+    }
+    if (h->model_hash != kv_snapshot_hash(model, sizeof(ModelBlobHeader)) ||
+        h->prompt_hash != kv_snapshot_hash(SYSTEM_PROMPT, strlen(SYSTEM_PROMPT)) ||
+        h->n_layers != p->n_layers || h->kv_dim != CONFIG_KV_DIM(p)) {
+        printf("KV snapshot was built for another model or system prompt\r\n");
+        return -1;
+    }
+    if (h->n_pos <= 0 || h->n_pos >= p->seq_len) {
+        printf("KV snapshot of %ld positions does not fit seq_len %d\r\n", (long)h->n_pos, p->seq_len);
+        return -1;
+    }
+    
+    // Same prompt text can still encode differently with another tokenizer
+    const int32_t* snapshot_tokens = (const int32_t*)(snapshot + sizeof(KVSnapshotHeader));
+    int same_tokens = h->n_pos == n_tokens;
+    for (int i = 0; same_tokens && i < n_tokens; i++) {
+        same_tokens = snapshot_tokens[i] == tokens[i];
+    }
+    if (!same_tokens) {
+        printf("KV snapshot was built with another tokenizer\r\n");
+        return -1;
+    }
+    
+    // Position records follow the token ids
+    const uint8_t* record = (const uint8_t*)(snapshot_tokens + h->n_pos);
+    size_t vector_bytes = h->kv_dim * sizeof(float);
+    kv_seq_truncate(seq, 0);
+    for (int pos = 0; pos < h->n_pos; pos++) {
+        if (kv_seq_reserve(seq, pos) != 0) {
+            kv_seq_truncate(seq, 0);
+            return -1;
+        }
+        for (int layer = 0; layer < h->n_layers; layer++) {
+            memcpy(kv_key(seq, layer, pos), record, vector_bytes);
+            memcpy(kv_value(seq, layer, pos), record + vector_bytes, vector_bytes);
+            record += 2 * vector_bytes;
+        }
+    }
+    return h->n_pos;
+}
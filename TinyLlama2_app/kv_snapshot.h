@@ -0,0 +1,43 @@
+#ifndef KV_SNAPSHOT_H
+#define KV_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyllama2.h"
+#include "kv_cache.h"
+
+// Every session starts with the same system prompt. Its KV cache is
+// computed at build time by scripts/build_kv_snapshot.c and linked in as a
+// const blob, so a session starts by forking it instead of prefilling.
+#define SYSTEM_PROMPT "You are TinyLlama2. Be brief."
+
+#define KV_SNAPSHOT_MAGIC   0x564B4C54u  // "TLKV"
+#define KV_SNAPSHOT_VERSION 2  // 2: keys are stored rotated (RoPE)
+
+// Header, then int32 tokens[n_pos], then one record per position:
+// float [n_layers][key, value][kv_dim]
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t model_hash;  // kv_snapshot_hash() of the model blob header (covers its data checksum)
+    uint32_t prompt_hash; // kv_snapshot_hash() of SYSTEM_PROMPT
+    int32_t n_layers;
+    int32_t kv_dim;
+    int32_t n_pos;
+    uint32_t reserved;
+} KVSnapshotHeader;
+
+// The linked-in snapshot, provided by kv_snapshot_data.c (NULL if none)
+extern const uint8_t* const kv_snapshot;
+
+// FNV-1a, used to tie a snapshot to its model and prompt
+uint32_t kv_snapshot_hash(const void* data, size_t size);
+
+// Copy the snapshot into seq if it matches the model, SYSTEM_PROMPT and
+// its tokens as the current tokenizer encodes them. Returns the number of
+// positions loaded, or -1 if it is absent or stale.
+int kv_snapshot_load(KVSequence* seq, const Config* p, const uint8_t* snapshot, const uint8_t* model,
+                     const int* tokens, int n_tokens);
+
+#endif // KV_SNAPSHOT_H
@@ -0,0 +1,8 @@
+// KV cache snapshot of SYSTEM_PROMPT
+// Placeholder: no snapshot is linked in, so the system prompt is prefilled
+// once at boot. Regenerate with scripts/build_kv_snapshot.c after changing
+// the model or the prompt.
+
+#include "kv_snapshot.h"
+
+const uint8_t* const kv_snapshot = NULL;
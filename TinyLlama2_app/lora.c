@@ -0,0 +1,83 @@
+#include "lora.h"
+#include <stdio.h>
+#include <string.h>
+
+static LoraAdapter adapters[LORA_MAX_ADAPTERS];
+static int n_adapters;
+
+static int load_adapter(LoraAdapter* lora, const uint8_t* blob, const Config* p) {
+    const LoraHeader* h = (const LoraHeader*)blob;
+    if (h->magic != LORA_MAGIC || h->version != LORA_VERSION) {
+        printf("Invalid LoRA adapter (magic 0x%08lX, version %lu)\r\n",
+               (unsigned long)h->magic, (unsigned long)h->version);
+        return -1;
+    }
+    if (h->n_layers != p->n_layers || h->rank <= 0 || h->rank > LORA_MAX_RANK) {
+        printf("LoRA adapter %.16s: %ld layers, rank %ld does not fit this model\r\n",
+               h->name, (long)h->n_layers, (long)h->rank);
+        return -1;
+    }
+    
+    // Input and output width of each adapted projection
+    int kv_dim = CONFIG_KV_DIM(p);
+    const int n[LORA_TARGET_COUNT] = { p->dim, p->dim, p->dim, p->dim, p->dim, p->hidden_dim, p->dim };
+    const int d[LORA_TARGET_COUNT] = { p->dim, kv_dim, kv_dim, p->dim, p->hidden_dim, p->dim, p->hidden_dim };
+    
+    for (int t = 0; t < LORA_TARGET_COUNT; t++) {
+        const TensorEntry* a = &h->a[t];
+        const TensorEntry* b = &h->b[t];
+        if (a->offset == 0 && b->offset == 0) {
+            lora->a[t] = lora->b[t] = NULL;
+            continue;
+        }
+        // A and B come as a pair, both past the header and inside the blob
+        size_t a_bytes = (size_t)h->n_layers * h->rank * n[t] * sizeof(float);
+        size_t b_bytes = (size_t)h->n_layers * d[t] * h->rank * sizeof(float);
+        if (a->offset < sizeof(*h) || b->offset < sizeof(*h)) {
+            printf("LoRA adapter %.16s: projection %d is missing its A or B factor\r\n", h->name, t);
+            return -1;
+        }
+        if (a->size != a_bytes || b->size != b_bytes ||
+            a->offset % MODEL_BLOB_ALIGN != 0 || b->offset % MODEL_BLOB_ALIGN != 0 ||
+            (size_t)a->offset + a->size > h->total_size || (size_t)b->offset + b->size > h->total_size) {
+            printf("LoRA adapter %.16s: projection %d has the wrong shape\r\n", h->name, t);
+            return -1;
+        }
+        lora->a[t] = (float*)(blob + a->offset);
+        lora->b[t] = (float*)(blob + b->offset);
+    }
+    lora->name = h->name;
+    lora->rank = h->rank;
+    lora->scale = h->scale;
+    return 0;
+}
+
+int lora_init(const Config* p) {
+    n_adapters = 0;
+    for (int i = 0; i < lora_adapter_count && n_adapters < LORA_MAX_ADAPTERS; i++) {
+        if (load_adapter(&adapters[n_adapters], lora_adapter_blobs[i], p) == 0) {
+            printf("- LoRA adapter: %.16s (rank %d)\r\n", adapters[n_adapters].name, adapters[n_adapters].rank);
+            n_adapters++;
+        }
+    }
+    return n_adapters;
+}
+
+int lora_max_rank(void) {
+    int rank = 0;
+    for (int i = 0; i < n_adapters; i++) {
+        if (adapters[i].rank > rank) {
+            rank = adapters[i].rank;
+        }
+    }
+    return rank;
+}
+
+const LoraAdapter* lora_find(const char* name) {
+    for (int i = 0; i < n_adapters; i++) {
+        if (strncmp(adapters[i].name, name, LORA_NAME_LEN) == 0) {
+            return &adapters[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,64 @@
+#ifndef LORA_H
+#define LORA_H
+
+#include <stdint.h>
+
+#include "tinyllama2.h"
+#include "model_blob.h"
+
+// LoRA adapters: per-layer low-rank deltas W' = W + scale * B @ A applied
+// next to the base projections, so one base blob serves several tasks and
+// each adapter costs only its A/B factors. Adapter blobs are emitted by
+// scripts/extract_weights.py --lora into lora_adapters.c and used in place.
+#define LORA_MAGIC   0x414C4C54u  // "TLLA"
+#define LORA_VERSION 1
+#define LORA_MAX_RANK 64
+#define LORA_MAX_ADAPTERS 8
+#define LORA_NAME_LEN 16
+
+// Adapted projections
+enum {
+    LORA_WQ = 0,
+    LORA_WK,
+    LORA_WV,
+    LORA_WO,
+    LORA_W1,
+    LORA_W2,
+    LORA_W3,
+    LORA_TARGET_COUNT
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    int32_t n_layers;
+    int32_t rank;
+    float scale;                       // lora_alpha / rank
+    char name[LORA_NAME_LEN];
+    TensorEntry a[LORA_TARGET_COUNT];  // (layer, rank, n), offset 0 if not adapted
+    TensorEntry b[LORA_TARGET_COUNT];  // (layer, d, rank)
+} LoraHeader;
+
+typedef struct LoraAdapter {
+    const char* name;
+    int rank;
+    float scale;
+    float* a[LORA_TARGET_COUNT];       // NULL when the projection is not adapted
+    float* b[LORA_TARGET_COUNT];
+} LoraAdapter;
+
+// Linked-in adapter blobs, provided by lora_adapters.c
+extern const uint8_t* const lora_adapter_blobs[];
+extern const int lora_adapter_count;
+
+// Check the linked-in adapters against the model; returns how many are usable
+int lora_init(const Config* p);
+
+// Adapter by name, NULL if none is linked in (run the base model)
+const LoraAdapter* lora_find(const char* name);
+
+// Largest rank of the usable adapters (sizes the A @ x scratch), 0 if none
+int lora_max_rank(void);
+
+#endif // LORA_H
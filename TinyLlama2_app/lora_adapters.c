@@ -0,0 +1,9 @@
+// LoRA adapters for the linked-in model
+// Placeholder: no adapters, every request runs the base model. Regenerate
+// with scripts/extract_weights.py --lora <adapter dir>.
+
+#include "lora.h"
+#include <stddef.h>
+
+const uint8_t* const lora_adapter_blobs[] = { NULL };
+const int lora_adapter_count = 0;
@@ -7,94 +7,47 @@
 #include "tinyllama2.h"
 #include "tokenizer.h"
 #include "utils.h"
+#include "boot_time.h"
+#include "lora.h"
+#include "kv_cache.h"
+#include "prompt_cache.h"
+#include "pretokenize.h"
+#include "response_index.h"
+#include "demo_questions.h"
 
 extern int stdout_init();
 
 // Global AI model instance
 static Transformer transformer;
 static Tokenizer tokenizer;
+static PromptCache prompt_cache;
 
-// Pre-defined questions and responses for demo
-typedef struct {
-    const char* question;
-    const char* response;
-} QAEntry;
+// Tokens the model may add after a question
+#define RESPONSE_MAX_TOKENS 16
 
-static const QAEntry qa_database[] = {
-    {"What is AI?", "AI is artificial intelligence that enables machines to simulate human thinking and decision-making processes."},
-    {"How does machine learning work?", "Machine learning uses algorithms to find patterns in data and make predictions without explicit programming."},
-    {"What is embedded AI?", "Embedded AI runs machine learning models directly on microcontrollers and small devices for real-time processing."},
-    {"Tell me about ARM processors", "ARM processors are energy-efficient chips used in smartphones, IoT devices, and embedded systems worldwide."},
-    {"What is a transformer model?", "Transformers use attention mechanisms to process sequences of data, revolutionizing natural language processing."},
-    {"How do neural networks learn?", "Neural networks learn by adjusting connection weights between neurons based on training data and feedback."},
-    {"What is deep learning?", "Deep learning uses multi-layered neural networks to automatically learn complex patterns from large datasets."},
-    {"Explain computer vision", "Computer vision enables machines to interpret and understand visual information from images and videos."},
-    {"What is natural language processing?", "NLP helps computers understand, interpret, and generate human language in a meaningful way."},
-    {"How does this microcontroller work?", "This ARM Cortex-M85 runs at high efficiency with dedicated AI acceleration for edge computing applications."}
-};
-
-#define QA_DATABASE_SIZE (sizeof(qa_database) / sizeof(QAEntry))
-
-// Simple question matching function
+// Canned answer for a question: one scan of its lowercase copy (from the
+// vectorized text front-end) through the build-time keyword index
 const char* find_response(const char* question) {
-    // Convert question to lowercase for matching
-    char normalized_question[256];
-    int len = strlen(question);
-    if (len >= 256) len = 255;
-    
-    for (int i = 0; i < len; i++) {
-        normalized_question[i] = (question[i] >= 'A' && question[i] <= 'Z') ? 
-                                question[i] + 32 : question[i];
-    }
-    normalized_question[len] = '\0';
-    
-    // Look for keyword matches
-    for (int i = 0; i < QA_DATABASE_SIZE; i++) {
-        // Simple substring matching
-        if (strstr(normalized_question, "ai") && strstr(qa_database[i].question, "AI")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "learn") && strstr(qa_database[i].question, "learning")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "embedded") && strstr(qa_database[i].question, "embedded")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "arm") && strstr(qa_database[i].question, "ARM")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "transform") && strstr(qa_database[i].question, "transformer")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "neural") && strstr(qa_database[i].question, "neural")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "deep") && strstr(qa_database[i].question, "deep")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "vision") && strstr(qa_database[i].question, "vision")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "language") && strstr(qa_database[i].question, "language")) {
-            return qa_database[i].response;
-        }
-        if (strstr(normalized_question, "microcontroller") && strstr(qa_database[i].question, "microcontroller")) {
-            return qa_database[i].response;
-        }
-    }
-    
-    // Default responses for common patterns
-    if (strstr(normalized_question, "hello") || strstr(normalized_question, "hi")) {
-        return "Hello! I'm TinyLlama2 running on ARM Cortex-M85. Ask me about AI, machine learning, or embedded systems!";
-    }
-    if (strstr(normalized_question, "how are you") || strstr(normalized_question, "how do you do")) {
-        return "I'm running efficiently on this microcontroller! My neural networks are processing at optimal performance.";
-    }
-    if (strstr(normalized_question, "what can you do") || strstr(normalized_question, "capabilities")) {
-        return "I can answer questions about AI, explain machine learning concepts, and demonstrate edge computing capabilities!";
+    static PreTokens text;
+    pretokenize(question, &text);
+    return response_index_lookup(&response_index, text.lower, text.len);
+}
+
+// KV blocks a session writes from pos for n_tokens of prompt and the answer
+static int kv_blocks_needed(int pos, int n_tokens, int seq_len) {
+    int end = pos + n_tokens + RESPONSE_MAX_TOKENS;
+    if (end > seq_len) {
+        end = seq_len;
     }
-    
-    return "I'm a specialized AI model focused on embedded systems and machine learning. Try asking about AI, neural networks, or ARM processors!";
+    return (end - 1) / KV_BLOCK_SIZE - pos / KV_BLOCK_SIZE + 1;
+}
+
+// Stream generated text as it arrives
+static int print_token(int token, const char* text, void* user) {
+    (void)token;
+    (void)user;
+    safe_printf(text);
+    return 0;
 }
 
 void process_ai_inference(const char* input_text) {
@@ -109,77 +62,111 @@ void process_ai_inference(const char* input_text) {
     // Show processing steps
     printf("🔄 Tokenizing input...\r\n");
     
-    printf("DEBUG: Creating token buffer\r\n");
-    
-    // Safe tokenization without potential crashes
-    int tokens[64];
+    // Canned and repeated questions come tokenized from the prompt cache;
+    // text too long for it is encoded here, into a static buffer to keep
+    // it off the small stack
+    static int tokens[TOKENIZER_MAX_TOKENS + 3];
+    const int* prompt = tokens;
     int n_tokens = 0;
-    
-    printf("DEBUG: Calculating text length\r\n");
-    
-    // Simple tokenization for safety
-    int text_len = strlen(input_text);
-    printf("DEBUG: Text length: %d\r\n", text_len);
-    
-    for (int i = 0; i < text_len && i < 60; i++) {
-        tokens[n_tokens++] = (int)input_text[i];
+    PromptCacheEntry* cached = prompt_cache_get(&prompt_cache, &tokenizer, input_text);
+    if (cached) {
+        prompt = cached->tokens;
+        n_tokens = cached->n_tokens;
+    } else {
+        encode(&tokenizer, input_text, 0, 0, tokens, &n_tokens);
     }
     
-    printf("   Generated %d tokens\r\n", n_tokens);
+    printf("   Generated %d tokens (prompt cache: %d hits, %d build-time, %d encoded)\r\n", n_tokens,
+           prompt_cache.hits, prompt_cache.prebuilt, prompt_cache.encoded);
+
+    // Stream the tokens back to text the way generated output is printed
+    static char text[DETOKENIZER_MAX_OUTPUT];
+    Detokenizer detokenizer;
+    detokenizer_init(&detokenizer);
+    printf("   Tokens decode to: ");
+    for (int i = 0; i < n_tokens; i++) {
+        detokenizer_push(&detokenizer, &tokenizer, prompt[i], text, sizeof(text));
+        safe_printf(text);
+    }
+    detokenizer_flush(&detokenizer, text, sizeof(text));
+    safe_printf(text);
+    printf("\r\n");
     
     printf("DEBUG: Starting transformer layers\r\n");
     
     printf("🧠 Running transformer layers...\r\n");
     
-    // Safe processing without hardware register access
-    for (int layer = 0; layer < N_LAYERS; layer++) {
-        printf("   Layer %d: Attention + FFN\r\n", layer + 1);
+    // Q&A adapter when one is linked in, the base model otherwise. The base
+    // model continues after the cached system prompt instead of prefilling
+    // it, or after the question itself when it was asked before, leaving
+    // generate() only the question's last token, whose logits start the answer
+    const LoraAdapter* adapter = lora_find("qa");
+    RunState* s = &transformer.state;
+    int seq_len = transformer.config.seq_len;
+    const int* question = prompt;
+    int n_question = n_tokens;
+    int pos;
+    if (!adapter && cached && cached->kv_len > 0) {
+        pos = resume_session(&transformer, &cached->kv, cached->kv_len);
+        printf("   Session resumes at position %d (question KV cached)\r\n", pos);
+        question = prompt + n_tokens - 1;
+        n_question = 1;
+    } else {
+        pos = start_session(&transformer, adapter);
+        printf("   Session starts at position %d (%s)\r\n", pos,
+               adapter ? "LoRA adapter qa" : "system prompt cached");
+        if (pos >= 0 && pos + n_tokens > seq_len) {
+            printf("   %d tokens do not fit the %d-position context, skipping the prefill\r\n",
+                   n_tokens, seq_len);
+            pos = -1;
+        }
+    }
+    
+    printf("🎯 Generating response...\r\n");
+    if (pos >= 0 && n_question > 0) {
+        // Every block the prefill and the answer write needs a free one (new,
+        // or a copy of a shared one); cached KV of older questions makes way
+        prompt_cache_reclaim(&prompt_cache, s->kv_pool, kv_blocks_needed(pos, n_question, seq_len));
         
-        // Processing delay without hardware access
-        for (volatile int i = 0; i < 100000; i++);
+        GenerateConfig config = { RESPONSE_MAX_TOKENS, 0.0f, 0, print_token, NULL };
+        GenerateStats stats;
+        printf("🧠 Model output: ");
+        int end = generate(&transformer, &tokenizer, question, n_question, pos, &config, &stats);
+        printf("\r\n");
+        if (end < 0) {
+            printf("   Generation failed: KV cache pool exhausted\r\n");
+        } else {
+            generate_report(&stats);
+            
+            // The question's KV, all but its last token, for when it is asked
+            // again. Stored after the answer, so generating it copied nothing
+            if (!adapter && cached && cached->kv_len == 0) {
+                prompt_cache_store_kv(cached, s->kv, pos + n_question - 1);
+            }
+        }
     }
     
     printf("DEBUG: About to find response\r\n");
     
-    printf("🎯 Generating response...\r\n");
-    
     // Get intelligent response
     const char* response = find_response(input_text);
     
     printf("DEBUG: Got response: %s\r\n", response ? response : "NULL");
     
-    // Simulate word-by-word generation
-    printf("💬 Response: ");
-    int resp_len = strlen(response);
-    for (int i = 0; i < resp_len; i++) {
-        printf("%c", response[i]);
-        if (response[i] == ' ' || response[i] == '.' || response[i] == ',') {
-            for (volatile int j = 0; j < 20000; j++); // Small delay between words
-        }
-    }
-    printf("\r\n");
+    printf("💬 Response: %s\r\n", response);
     
     printf("✅ Inference complete!\r\n\r\n");
     printf("DEBUG: Exiting process_ai_inference\r\n");
 }
 
 void interactive_qa_session() {
-    const char* predefined_questions[] = {
-        "What is AI?",
-        "How does machine learning work?",
-        "What is embedded AI?",
-        "Tell me about ARM processors",
-        "What is a transformer model?",
-        "Hello, how are you?"
-    };
-    
-    const int num_questions = sizeof(predefined_questions) / sizeof(predefined_questions[0]);
+    const int num_questions = demo_session_questions.count;
     static int question_index = 0;
     
     printf("🎓 Interactive Q&A Session Starting...\r\n");
     printf("Question %d of %d:\r\n", question_index + 1, num_questions);
     
-    const char* current_question = predefined_questions[question_index];
+    const char* current_question = demo_session_questions.questions[question_index];
     process_ai_inference(current_question);
     
     question_index = (question_index + 1) % num_questions;
@@ -193,17 +180,19 @@ void monitor_hardware_input() {
     // Every 50 calls, simulate detecting some input for demo
     if (monitor_calls == 50) {
         printf("🎛️  Hardware Input Detected - Simulated Switch 0x01\r\n");
-        process_ai_inference("What is artificial intelligence?");
+        process_ai_inference(demo_switch_questions.questions[0]);
     } else if (monitor_calls == 100) {
         printf("🎛️  Hardware Input Detected - Simulated Switch 0x02\r\n");
-        process_ai_inference("How does deep learning work?");
+        process_ai_inference(demo_switch_questions.questions[1]);
         monitor_calls = 0; // Reset counter
     }
 }
 
 int main() {
+    boot_mark("startup (C runtime init)");
     __enable_irq();
     stdout_init();
+    boot_mark("stdout");
     
     printf("\r\n");
     printf("🚀 ================================================\r\n");
@@ -232,33 +221,45 @@ int main() {
     printf("DEBUG: About to initialize tokenizer\r\n");
     
     // Initialize tokenizer
-    if (build_tokenizer(&tokenizer, NULL, VOCAB_SIZE) == 0) {
+    if (build_tokenizer(&tokenizer, NULL, transformer.config.vocab_size) == 0) {
         printf("✅ Tokenizer initialized successfully\r\n");
+        boot_mark("tokenizer");
     } else {
         printf("❌ Failed to initialize tokenizer\r\n");
         return -1; // Exit if tokenizer fails
     }
     
+    // KV cache of the shared system prompt, from the build-time snapshot
+    if (load_system_prompt(&transformer, &tokenizer) == 0) {
+        boot_mark("system prompt");
+        prompt_cache_init(&prompt_cache, &tokenizer, transformer.state.kv_pool);
+    } else {
+        printf("❌ Failed to load the system prompt\r\n");
+        return -1;
+    }
+    
     printf("DEBUG: Model initialization complete\r\n");
     
-    printf("🧠 Neural network layers: %d\r\n", N_LAYERS);
-    printf("🎯 Attention heads: %d\r\n", N_HEADS);
-    printf("� Model dimension: %d\r\n", DIM);
-    printf("�📝 Vocabulary size: %d\r\n", VOCAB_SIZE);
+    printf("🧠 Neural network layers: %d\r\n", transformer.config.n_layers);
+    printf("🎯 Attention heads: %d\r\n", transformer.config.n_heads);
+    printf("� Model dimension: %d\r\n", transformer.config.dim);
+    printf("�📝 Vocabulary size: %d\r\n", transformer.config.vocab_size);
     printf("⚡ Optimized for embedded deployment\r\n");
-    printf("🚀 Model ready for intelligent conversations!\r\n\r\n");
+    printf("🚀 Model ready for intelligent conversations!\r\n");
+    boot_report();
+    printf("\r\n");
     
     // Welcome demonstration
     printf("🎉 Welcome Demo:\r\n");
     printf("DEBUG: About to call process_ai_inference\r\n");
-    process_ai_inference("Hello, what can you tell me about AI?");
+    process_ai_inference(demo_boot_questions.questions[0]);
     printf("DEBUG: Returned from process_ai_inference\r\n");
     
     // Run a few more demos automatically for simulation
     printf("🎛️  Auto-demo mode for simulation:\r\n");
-    process_ai_inference("What is machine learning?");
-    process_ai_inference("How does embedded AI work?");
-    process_ai_inference("Tell me about ARM processors");
+    for (int i = 1; i < demo_boot_questions.count; i++) {
+        process_ai_inference(demo_boot_questions.questions[i]);
+    }
     
     printf("🎛️  Switch Controls (for interactive use):\r\n");
     printf("   0x01 - Ask about AI\r\n");
@@ -280,12 +281,7 @@ int main() {
             // Simulate some switch changes for demo
             if (demo_count % 3 == 0) {
                 printf("🎮 Simulation: Auto-triggering demo %d\r\n", demo_count + 1);
-                const char* demo_questions[] = {
-                    "What is deep learning?",
-                    "How does computer vision work?",
-                    "What can you do?"
-                };
-                process_ai_inference(demo_questions[demo_count % 3]);
+                process_ai_inference(demo_loop_questions.questions[demo_count % demo_loop_questions.count]);
             }
             demo_count++;
         }
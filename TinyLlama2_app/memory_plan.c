@@ -0,0 +1,127 @@
+#include "memory_plan.h"
+#include "arena.h"
+#include <stdio.h>
+#include <string.h>
+
+// Quiet NaN, so a read of a dead buffer also shows up in the logits
+#define PLAN_POISON 0x7FBADBADu
+
+#define PLAN_ROUND_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static int lifetimes_overlap(const PlanBuffer* a, const PlanBuffer* b) {
+    return a->first <= b->last && b->first <= a->last;
+}
+
+size_t memory_plan_solve(PlanBuffer* buffers, int n, size_t* bank_bytes) {
+    // Placement order: largest first (n is small, selection sort is fine)
+    int order[32];
+    if (n > 32) {
+        return 0;
+    }
+    for (int b = 0; b < PLAN_MAX_BANKS; b++) {
+        bank_bytes[b] = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (buffers[i].bank < 0 || buffers[i].bank >= PLAN_MAX_BANKS) {
+            return 0;
+        }
+        order[i] = i;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            if (buffers[order[j]].bytes > buffers[order[i]].bytes) {
+                int t = order[i];
+                order[i] = order[j];
+                order[j] = t;
+            }
+        }
+    }
+    
+    for (int i = 0; i < n; i++) {
+        PlanBuffer* b = &buffers[order[i]];
+        size_t size = PLAN_ROUND_UP(b->bytes);
+        size_t offset = 0;
+        
+        // Bump past every placed buffer of the bank that is live at the same
+        // time and overlaps the candidate range, until the range is free
+        int moved = 1;
+        while (moved) {
+            moved = 0;
+            for (int j = 0; j < i; j++) {
+                const PlanBuffer* p = &buffers[order[j]];
+                size_t p_end = p->offset + PLAN_ROUND_UP(p->bytes);
+                if (p->bytes == 0 || p->bank != b->bank || !lifetimes_overlap(b, p)) {
+                    continue;
+                }
+                if (offset < p_end && p->offset < offset + size) {
+                    offset = p_end;
+                    moved = 1;
+                }
+            }
+        }
+        
+        b->offset = offset;
+        if (offset + size > bank_bytes[b->bank]) {
+            bank_bytes[b->bank] = offset + size;
+        }
+    }
+    
+    size_t total = 0;
+    for (int b = 0; b < PLAN_MAX_BANKS; b++) {
+        total += bank_bytes[b];
+    }
+    return total;
+}
+
+void memory_plan_report(const PlanBuffer* buffers, int n, size_t total) {
+    size_t disjoint = 0;
+    for (int i = 0; i < n; i++) {
+        disjoint += PLAN_ROUND_UP(buffers[i].bytes);
+    }
+    printf("Activation plan: %u bytes (%u without aliasing)\r\n", (unsigned)total, (unsigned)disjoint);
+    for (int i = 0; i < n; i++) {
+        const PlanBuffer* b = &buffers[i];
+        if (b->bytes > 0) {
+            printf("  %-8s %6u bytes in bank %d at +%-6u steps %d-%d\r\n", b->name, (unsigned)b->bytes,
+                   b->bank, (unsigned)b->offset, b->first, b->last);
+        }
+    }
+}
+
+int memory_plan_step(MemoryPlan* plan, int step) {
+    int prev = plan->step;
+    int status = 0;
+    plan->step = step;
+    
+    // A buffer carries data into this step if it was written before it and
+    // is still read at or after it. Going backwards (next layer, next
+    // token) only buffers spanning the whole gap survive.
+    int lo = prev < step - 1 ? prev : step - 1;
+    int hi = prev > step ? prev : step;
+    
+    // Poison everything that died first, then scan what must have survived
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < plan->n_buffers; i++) {
+            const PlanBuffer* b = &plan->buffers[i];
+            uint32_t* words = (uint32_t*)(plan->base[b->bank] + b->offset);
+            size_t n_words = b->bytes / sizeof(uint32_t);
+            int was_live = b->first <= prev && prev <= b->last;
+            int carried = b->first <= lo && b->last >= hi;
+            
+            if (pass == 0 && was_live && !carried) {
+                for (size_t w = 0; w < n_words; w++) {
+                    words[w] = PLAN_POISON;
+                }
+            } else if (pass == 1 && carried && !b->sparse) {
+                for (size_t w = 0; w < n_words; w++) {
+                    if (words[w] == PLAN_POISON) {
+                        printf("Memory plan violation: %s clobbered before step %d\r\n", b->name, step);
+                        status = -1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return status;
+}
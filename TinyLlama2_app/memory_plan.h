@@ -0,0 +1,65 @@
+#ifndef MEMORY_PLAN_H
+#define MEMORY_PLAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Static liveness plan for the activation buffers. Each buffer is live
+// from the step of transformer_forward() that first writes it to the last
+// step that reads it; buffers whose lifetimes never overlap share memory.
+// Offsets are assigned greedily, largest buffer first, at the lowest
+// address that does not collide with an already placed, overlapping one.
+// Each buffer names the bank (arena) it lives in; buffers in different
+// banks never share memory.
+
+#define PLAN_MAX_BANKS 4  // one per DTCM bank (DTCM_BANKS)
+
+// Steps of one forward pass in execution order. STEP_ATTN_NORM..STEP_W2
+// repeat for every layer.
+enum {
+    STEP_EMBED,       // x = embedding row
+    STEP_ATTN_NORM,   // xb = rmsnorm(x)
+    STEP_QKV,         // q, k, v projections
+    STEP_SCORES,      // att = q . k
+    STEP_MIX,         // xb2 = att-weighted v
+    STEP_WO,          // xb = wo @ xb2
+    STEP_FFN_NORM,    // xb = rmsnorm(x)
+    STEP_FFN_UP,      // hb, hb2 = w1, w3 projections, gated SiLU
+    STEP_W2,          // xb = w2 @ hb
+    STEP_FINAL_NORM,  // x = rmsnorm(x)
+    STEP_CLASSIFIER,  // logits = wcls @ x, read by the caller after forward()
+    STEP_COUNT
+};
+
+typedef struct {
+    const char* name;
+    size_t bytes;
+    int first;        // first step that writes the buffer
+    int last;         // last step that reads it
+    int sparse;       // not fully written each time, skipped by the poison scan
+    int bank;         // arena the buffer is placed in, 0 .. PLAN_MAX_BANKS - 1
+    size_t offset;    // from the start of its bank, assigned by memory_plan_solve
+} PlanBuffer;
+
+typedef struct MemoryPlan {
+    uint8_t* base[PLAN_MAX_BANKS];
+    PlanBuffer* buffers;
+    int n_buffers;
+    int step;         // step the last memory_plan_step() call entered
+} MemoryPlan;
+
+// Assign offsets (ARENA_ALIGN aligned) within each buffer's bank and set
+// bank_bytes[0 .. PLAN_MAX_BANKS) to what every bank needs; returns the
+// total, 0 if a buffer names no valid bank
+size_t memory_plan_solve(PlanBuffer* buffers, int n, size_t* bank_bytes);
+
+// Print the banks, offsets and lifetimes next to what disjoint buffers
+// would cost
+void memory_plan_report(const PlanBuffer* buffers, int n, size_t total);
+
+// Debug check (RUN_STATE_PLAN_CHECK): on entering a step, poison every
+// buffer that died since the previous step and verify that buffers carried
+// over were not clobbered by an alias. Returns -1 on a violation.
+int memory_plan_step(MemoryPlan* plan, int step);
+
+#endif // MEMORY_PLAN_H
@@ -0,0 +1,74 @@
+#ifndef MODEL_BLOB_H
+#define MODEL_BLOB_H
+
+#include <stdint.h>
+
+// Flat model weight blob: a header with the model config and a tensor
+// offset table, followed by the tensor data. Every tensor starts on a
+// MODEL_BLOB_ALIGN boundary so it can be used in place from ROM/QSPI.
+#define MODEL_BLOB_MAGIC   0x324C4C54u  // "TLL2"
+#define MODEL_BLOB_VERSION 1
+#define MODEL_BLOB_ALIGN   16
+
+// Linker section for the blob, see .model_blob in gcc_linker_script.ld.src
+#if defined(__ARM_ARCH)
+#define MODEL_BLOB_SECTION __attribute__((section(".model_blob"), aligned(MODEL_BLOB_ALIGN)))
+#else
+#define MODEL_BLOB_SECTION __attribute__((aligned(MODEL_BLOB_ALIGN)))
+#endif
+
+// Tensors in the offset table
+enum {
+    TENSOR_TOKEN_EMBEDDING = 0,
+    TENSOR_RMS_ATT,
+    TENSOR_RMS_FFN,
+    TENSOR_WQ,
+    TENSOR_WK,
+    TENSOR_WV,
+    TENSOR_WO,
+    TENSOR_W1,
+    TENSOR_W2,
+    TENSOR_W3,
+    TENSOR_RMS_FINAL,
+    TENSOR_WCLS,          // absent when the classifier shares the embedding
+    TENSOR_COUNT
+};
+
+// Parts of a tensor, unused parts have offset 0
+enum {
+    TENSOR_PART_DATA = 0, // fp32 weights or packed quantized weights
+    TENSOR_PART_SCALE,    // Q8 / ternary scales
+    TENSOR_PART_CODEBOOK, // CB4 / CB8 fp16 centroids
+    TENSOR_PART_LOWRANK_U,
+    TENSOR_PART_LOWRANK_V,
+    TENSOR_PART_COUNT
+};
+
+typedef struct {
+    uint32_t offset;      // bytes from the start of the blob, 0 if absent
+    uint32_t size;        // bytes
+} TensorEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;  // header plus all tensor data, in bytes
+    int32_t dim;
+    int32_t hidden_dim;
+    int32_t n_layers;
+    int32_t n_heads;
+    int32_t n_kv_heads;
+    int32_t vocab_size;
+    int32_t seq_len;
+    int32_t weight_format;
+    int32_t lowrank_rank;
+    uint32_t checksum;    // CRC-32 of everything after the header, 0 if not recorded
+    float rope_theta;     // rotary embedding base, 0 for the Llama 2 default (10000)
+    uint32_t reserved[2];
+    TensorEntry tensors[TENSOR_COUNT][TENSOR_PART_COUNT];
+} ModelBlobHeader;
+
+// The linked-in model, provided by model_weights.c
+extern const uint8_t* const model_blob;
+
+#endif // MODEL_BLOB_H
@@ -2,28 +2,62 @@
 // In production, these would be the actual quantized model weights
 
 #include "tinyllama2.h"
+#include "model_blob.h"
+#include <stddef.h>
 
-// Demo weights - in real implementation these would be loaded from flash
-// For now, just declare placeholder arrays to satisfy the linker
+// Placeholder fp32 model blob with the compile-time dimensions. The layout
+// is exactly what scripts/extract_weights.py emits: header, offset table,
+// then tensors on MODEL_BLOB_ALIGN boundaries. The classifier shares the
+// token embedding, so there is no WCLS entry.
+typedef struct {
+    ModelBlobHeader header;
+    float token_embedding_table[VOCAB_SIZE * DIM];
+    float rms_att_weight[N_LAYERS * DIM];
+    float rms_ffn_weight[N_LAYERS * DIM];
+    float wq[N_LAYERS * DIM * DIM];
+    float wk[N_LAYERS * KV_DIM * DIM];
+    float wv[N_LAYERS * KV_DIM * DIM];
+    float wo[N_LAYERS * DIM * DIM];
+    float w1[N_LAYERS * HIDDEN_DIM * DIM];
+    float w2[N_LAYERS * DIM * HIDDEN_DIM];
+    float w3[N_LAYERS * HIDDEN_DIM * DIM];
+    float rms_final_weight[DIM];
+} DemoModelBlob;
 
-// Token embeddings (simplified)
-float demo_token_embeddings[1000];
+#define DEMO_TENSOR(field) \
+    { offsetof(DemoModelBlob, field), sizeof(((DemoModelBlob*)0)->field) }
 
-// Attention weights (simplified)
-float demo_attention_weights[1000];
+static const DemoModelBlob demo_model_blob MODEL_BLOB_SECTION = {
+    .header = {
+        .magic = MODEL_BLOB_MAGIC,
+        .version = MODEL_BLOB_VERSION,
+        .total_size = sizeof(DemoModelBlob),
+        .dim = DIM,
+        .hidden_dim = HIDDEN_DIM,
+        .n_layers = N_LAYERS,
+        .n_heads = N_HEADS,
+        .n_kv_heads = N_KV_HEADS,
+        .vocab_size = VOCAB_SIZE,
+        .seq_len = MAX_SEQ_LEN,
+        .weight_format = WEIGHT_FORMAT_F32,
+        .lowrank_rank = 0,
+        .tensors = {
+            [TENSOR_TOKEN_EMBEDDING][TENSOR_PART_DATA] = DEMO_TENSOR(token_embedding_table),
+            [TENSOR_RMS_ATT][TENSOR_PART_DATA] = DEMO_TENSOR(rms_att_weight),
+            [TENSOR_RMS_FFN][TENSOR_PART_DATA] = DEMO_TENSOR(rms_ffn_weight),
+            [TENSOR_WQ][TENSOR_PART_DATA] = DEMO_TENSOR(wq),
+            [TENSOR_WK][TENSOR_PART_DATA] = DEMO_TENSOR(wk),
+            [TENSOR_WV][TENSOR_PART_DATA] = DEMO_TENSOR(wv),
+            [TENSOR_WO][TENSOR_PART_DATA] = DEMO_TENSOR(wo),
+            [TENSOR_W1][TENSOR_PART_DATA] = DEMO_TENSOR(w1),
+            [TENSOR_W2][TENSOR_PART_DATA] = DEMO_TENSOR(w2),
+            [TENSOR_W3][TENSOR_PART_DATA] = DEMO_TENSOR(w3),
+            [TENSOR_RMS_FINAL][TENSOR_PART_DATA] = DEMO_TENSOR(rms_final_weight),
+        },
+    },
+};
 
-// FFN weights (simplified)  
-float demo_ffn_weights[1000];
-
-// Initialize demo weights with some values
-void init_demo_weights(void) {
-    // Initialize with small random-like values for demo
-    for (int i = 0; i < 1000; i++) {
-        demo_token_embeddings[i] = 0.01f * (i % 100 - 50);
-        demo_attention_weights[i] = 0.001f * (i % 200 - 100);
-        demo_ffn_weights[i] = 0.005f * (i % 150 - 75);
-    }
-}
+const uint8_t* const model_blob = (const uint8_t*)&demo_model_blob;
 
 // Model configuration constants
 const int model_vocab_size = VOCAB_SIZE;
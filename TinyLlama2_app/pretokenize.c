@@ -0,0 +1,73 @@
+#include "pretokenize.h"
+#include <string.h>
+
+#if defined(ARM_MATH_CM55) && defined(__ARM_FEATURE_MVE)
+#include <arm_mve.h>
+#define PRETOKENIZE_HELIUM
+#endif
+
+#define BLOCK_BYTES 16
+
+// Find the blanks (' ', where pieces split) among n (<= 16) bytes, one bit
+// per byte, and write the bytes lowercased
+static uint32_t scan_block(const uint8_t* src, uint8_t* lower, int n) {
+#ifdef PRETOKENIZE_HELIUM
+    // All 16 lanes at once; the tail predicate keeps loads and stores
+    // inside the text
+    mve_pred16_t p = vctp8q(n);
+    uint8x16_t v = vldrbq_z_u8(src, p);
+    mve_pred16_t upper = vcmphiq_u8(vdupq_n_u8(26), vsubq_n_u8(v, 'A')) & p;
+    vstrbq_p_u8(lower, vaddq_m_n_u8(v, v, 'a' - 'A', upper), p);
+    return vcmpeqq_n_u8(v, ' ') & p;
+#else
+    uint32_t blank = 0;
+    for (int i = 0; i < n; i++) {
+        uint8_t c = src[i];
+        int upper = (uint8_t)(c - 'A') < 26;
+        blank |= (uint32_t)(c == ' ') << i;
+        lower[i] = upper ? c + ('a' - 'A') : c;
+    }
+    return blank;
+#endif
+}
+
+static void add_piece(PreTokens* out, int start, int end) {
+    if (out->n_pieces == PRETOKENIZE_MAX_SPANS) {
+        // Out of spans: the last piece runs on, BPE over it is still exact
+        TextSpan* last = &out->pieces[out->n_pieces - 1];
+        last->len = (uint16_t)(end - last->start);
+        return;
+    }
+    out->pieces[out->n_pieces++] = (TextSpan){ (uint16_t)start, (uint16_t)(end - start) };
+}
+
+int pretokenize(const char* text, PreTokens* out) {
+    size_t len = strlen(text);
+    out->truncated = len > PRETOKENIZE_MAX_BYTES;
+    if (out->truncated) {
+        len = PRETOKENIZE_MAX_BYTES;
+    }
+    out->len = (int)len;
+    out->n_pieces = 0;
+
+    // A piece starts at each blank after a non-blank
+    int piece_start = 0;
+    uint32_t prev_blank = 1;
+    for (int base = 0; base < (int)len; base += BLOCK_BYTES) {
+        int n = (int)len - base < BLOCK_BYTES ? (int)len - base : BLOCK_BYTES;
+        uint32_t blank = scan_block((const uint8_t*)text + base, (uint8_t*)out->lower + base, n);
+        uint32_t starts = blank & ~((blank << 1) | prev_blank);
+        while (starts) {
+            int i = base + __builtin_ctz(starts);
+            add_piece(out, piece_start, i);
+            piece_start = i;
+            starts &= starts - 1;
+        }
+        prev_blank = (blank >> (n - 1)) & 1;
+    }
+    if (len > 0) {
+        add_piece(out, piece_start, (int)len);
+    }
+    out->lower[len] = '\0';
+    return (int)len;
+}
@@ -0,0 +1,32 @@
+#ifndef PRETOKENIZE_H
+#define PRETOKENIZE_H
+
+#include <stdint.h>
+
+// Text front-end shared by encode() and the response matcher: one pass
+// over the input, 16 bytes at a time (Helium byte lanes on M55/M85,
+// per-byte range compares elsewhere), writes a lowercased copy for the
+// keyword scan and finds the BPE pre-tokens: a run of spaces and the text
+// up to the next one. SentencePiece pieces never hold a space after other
+// text, so merging within each piece gives the same tokens as the whole text.
+
+#define PRETOKENIZE_MAX_BYTES 1024   // longer text is truncated
+#define PRETOKENIZE_MAX_SPANS 256    // extra pieces join the last one
+
+typedef struct {
+    uint16_t start;
+    uint16_t len;
+} TextSpan;
+
+typedef struct {
+    char lower[PRETOKENIZE_MAX_BYTES + 1]; // text with ASCII letters lowercased
+    int len;                               // bytes scanned
+    int truncated;                         // text was longer than PRETOKENIZE_MAX_BYTES
+    int n_pieces;
+    TextSpan pieces[PRETOKENIZE_MAX_SPANS];
+} PreTokens;
+
+// Scan text into out; returns the number of bytes scanned
+int pretokenize(const char* text, PreTokens* out);
+
+#endif // PRETOKENIZE_H
@@ -0,0 +1,151 @@
+#include "prompt_cache.h"
+#include "kv_snapshot.h"
+#include <stdio.h>
+#include <string.h>
+
+uint32_t prompt_cache_tokenizer_id(const Tokenizer* t) {
+    // The blob's CRC-32 covers the scores, offsets and pieces, so any
+    // regenerated vocabulary changes it
+    uint32_t fields[3] = { (uint32_t)t->vocab_size, t->hash.n_slots, t->checksum };
+    return kv_snapshot_hash(fields, sizeof(fields));
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+int prompt_normalize(const char* text, char* out, size_t out_size) {
+    size_t len = 0;
+    int pending_space = 0;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (is_space(*c)) {
+            pending_space = len > 0;
+            continue;
+        }
+        if (len + pending_space + 1 >= out_size) {
+            return -1;
+        }
+        if (pending_space) {
+            out[len++] = ' ';
+            pending_space = 0;
+        }
+        out[len++] = *c;
+    }
+    if (out_size == 0) {
+        return -1;
+    }
+    out[len] = '\0';
+    return (int)len;
+}
+
+uint32_t prompt_key(const char* normalized) {
+    uint32_t key = piece_hash(0, normalized);
+    return key != 0 ? key : 1; // 0 marks a free entry
+}
+
+void prompt_cache_init(PromptCache* c, const Tokenizer* t, KVPool* pool) {
+    memset(c, 0, sizeof(*c));
+    for (int i = 0; i < PROMPT_CACHE_ENTRIES; i++) {
+        kv_seq_init(&c->entries[i].kv, pool);
+    }
+
+    // Build-time tokens are only valid for the vocabulary they came from
+    if (prompt_cache_table.n_records > 0) {
+        if (prompt_cache_table.tokenizer_id == prompt_cache_tokenizer_id(t)) {
+            c->table = &prompt_cache_table;
+            printf("Prompt cache: %d prompts tokenized at build time\r\n", prompt_cache_table.n_records);
+        } else {
+            printf("Prompt cache: build-time prompts are for another tokenizer, ignoring them\r\n");
+        }
+    }
+}
+
+static void release_kv(PromptCacheEntry* e) {
+    kv_seq_truncate(&e->kv, 0);
+    e->kv_len = 0;
+}
+
+PromptCacheEntry* prompt_cache_get(PromptCache* c, Tokenizer* t, const char* text) {
+    char normalized[PROMPT_CACHE_MAX_TEXT];
+    if (prompt_normalize(text, normalized, sizeof(normalized)) < 0) {
+        return NULL;
+    }
+    uint32_t key = prompt_key(normalized);
+
+    // LRU entries, the key is confirmed against the text
+    PromptCacheEntry* victim = &c->entries[0];
+    for (int i = 0; i < PROMPT_CACHE_ENTRIES; i++) {
+        PromptCacheEntry* e = &c->entries[i];
+        if (e->key == key && strcmp(e->text, normalized) == 0) {
+            e->last_used = ++c->clock;
+            c->hits++;
+            return e;
+        }
+        if (victim->key != 0 && (e->key == 0 || e->last_used < victim->last_used)) {
+            victim = e;
+        }
+    }
+
+    // Miss: tokens from the build-time table, or encoded. A prompt too long
+    // to cache returns before the least recently used entry is evicted
+    static int tokens[PROMPT_CACHE_MAX_TEXT + 2];
+    int n_tokens = 0;
+    const PromptCacheRecord* record = NULL;
+    for (int i = 0; c->table && i < c->table->n_records; i++) {
+        const PromptCacheRecord* r = &c->table->records[i];
+        if (r->key == key && strcmp(r->text, normalized) == 0) {
+            record = r;
+            break;
+        }
+    }
+    if (record) {
+        n_tokens = record->n_tokens;
+        for (int i = 0; i < n_tokens && i < PROMPT_CACHE_MAX_TOKENS; i++) {
+            tokens[i] = c->table->tokens[record->offset + i];
+        }
+    } else {
+        encode(t, normalized, 0, 0, tokens, &n_tokens);
+    }
+    if (n_tokens > PROMPT_CACHE_MAX_TOKENS) {
+        return NULL;
+    }
+
+    release_kv(victim);
+    memcpy(victim->tokens, tokens, n_tokens * sizeof(int));
+    victim->n_tokens = n_tokens;
+    if (record) {
+        c->prebuilt++;
+    } else {
+        c->encoded++;
+    }
+    memcpy(victim->text, normalized, sizeof(normalized));
+    victim->key = key;
+    victim->last_used = ++c->clock;
+    return victim;
+}
+
+void prompt_cache_store_kv(PromptCacheEntry* e, const KVSequence* kv, int kv_len) {
+    // Shares the session's blocks up to kv_len: nothing is copied, and the
+    // session's next write into the last one copies that block instead
+    release_kv(e);
+    kv_seq_fork(&e->kv, kv);
+    kv_seq_truncate(&e->kv, kv_len);
+    e->kv_len = kv_len;
+}
+
+int prompt_cache_reclaim(PromptCache* c, const KVPool* pool, int n_blocks) {
+    while (pool->n_free < n_blocks) {
+        PromptCacheEntry* oldest = NULL;
+        for (int i = 0; i < PROMPT_CACHE_ENTRIES; i++) {
+            PromptCacheEntry* e = &c->entries[i];
+            if (e->kv_len > 0 && (!oldest || e->last_used < oldest->last_used)) {
+                oldest = e;
+            }
+        }
+        if (!oldest) {
+            return -1;
+        }
+        release_kv(oldest);
+    }
+    return 0;
+}
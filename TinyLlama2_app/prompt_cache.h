@@ -0,0 +1,82 @@
+#ifndef PROMPT_CACHE_H
+#define PROMPT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tokenizer.h"
+#include "kv_cache.h"
+
+// Cache of tokenized prompts, keyed by a hash of the normalized text
+// (whitespace trimmed and collapsed; case is kept, it changes the tokens).
+// The questions the demo asks are tokenized at build time by
+// scripts/build_prompt_cache.c and linked in as const tables. Other inputs
+// are encoded once into a small LRU, whose entries also keep the KV cache
+// after the prompt while the pool has blocks to spare, so a repeated
+// request skips both encode() and the prefill.
+
+#define PROMPT_CACHE_MAX_TEXT 128      // longest cached prompt, in bytes with the NUL
+#define PROMPT_CACHE_MAX_TOKENS 64
+#ifndef PROMPT_CACHE_ENTRIES
+#define PROMPT_CACHE_ENTRIES 8
+#endif
+
+// Build-time prompt, its tokens are tokens[offset .. offset + n_tokens)
+typedef struct {
+    uint32_t key;
+    uint16_t offset;
+    uint16_t n_tokens;
+    const char* text;                  // normalized
+} PromptCacheRecord;
+
+typedef struct {
+    uint32_t tokenizer_id;             // prompt_cache_tokenizer_id() it was built with
+    int n_records;
+    const PromptCacheRecord* records;
+    const int32_t* tokens;
+} PromptCacheTable;
+
+// The linked-in table, provided by prompt_cache_data.c
+extern const PromptCacheTable prompt_cache_table;
+
+typedef struct {
+    uint32_t key;                      // 0 for a free entry
+    uint32_t last_used;
+    char text[PROMPT_CACHE_MAX_TEXT];
+    int n_tokens;
+    int tokens[PROMPT_CACHE_MAX_TOKENS];
+    int kv_len;                        // positions in kv (system prompt + tokens), 0 if none
+    KVSequence kv;
+} PromptCacheEntry;
+
+typedef struct {
+    PromptCacheEntry entries[PROMPT_CACHE_ENTRIES];
+    uint32_t clock;
+    const PromptCacheTable* table;     // NULL when built for another tokenizer
+    int hits;                          // found in the LRU
+    int prebuilt;                      // copied from the build-time table
+    int encoded;
+} PromptCache;
+
+// Fingerprint of the vocabulary a table was tokenized with
+uint32_t prompt_cache_tokenizer_id(const Tokenizer* t);
+
+// Trim and collapse whitespace into out; returns the length, or -1 if it
+// does not fit in out_size
+int prompt_normalize(const char* text, char* out, size_t out_size);
+uint32_t prompt_key(const char* normalized);
+
+void prompt_cache_init(PromptCache* c, const Tokenizer* t, KVPool* pool);
+
+// Tokens of text (no BOS), from the cache or encoded into it. Returns NULL
+// when text is too long to cache; the caller encodes it directly.
+PromptCacheEntry* prompt_cache_get(PromptCache* c, Tokenizer* t, const char* text);
+
+// Keep the first kv_len positions of a base-model session with the entry
+void prompt_cache_store_kv(PromptCacheEntry* e, const KVSequence* kv, int kv_len);
+
+// Drop cached KV, least recently used first, until the pool has n_blocks
+// free. Returns -1 if it cannot.
+int prompt_cache_reclaim(PromptCache* c, const KVPool* pool, int n_blocks);
+
+#endif // PROMPT_CACHE_H
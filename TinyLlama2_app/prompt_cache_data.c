@@ -0,0 +1,51 @@
+// Build-time prompt cache for TinyLlama2
+// Generated automatically by scripts/build_prompt_cache.c
+
+#include "prompt_cache.h"
+
+static const int32_t prompt_tokens[367] = {
+    35, 75, 104, 111, 111, 114, 47, 35, 122, 107, 100, 119, 35, 102, 100, 113,
+    35, 124, 114, 120, 35, 119, 104, 111, 111, 35, 112, 104, 35, 100, 101, 114,
+    120, 119, 35, 68, 76, 66, 35, 90, 107, 100, 119, 35, 108, 118, 35, 112,
+    100, 102, 107, 108, 113, 104, 35, 111, 104, 100, 117, 113, 108, 113, 106, 66,
+    35, 75, 114, 122, 35, 103, 114, 104, 118, 35, 104, 112, 101, 104, 103, 103,
+    104, 103, 35, 68, 76, 35, 122, 114, 117, 110, 66, 35, 87, 104, 111, 111,
+    35, 112, 104, 35, 100, 101, 114, 120, 119, 35, 68, 85, 80, 35, 115, 117,
+    114, 102, 104, 118, 118, 114, 117, 118, 35, 90, 107, 100, 119, 35, 108, 118,
+    35, 68, 76, 66, 35, 75, 114, 122, 35, 103, 114, 104, 118, 35, 112, 100,
+    102, 107, 108, 113, 104, 35, 111, 104, 100, 117, 113, 108, 113, 106, 35, 122,
+    114, 117, 110, 66, 35, 90, 107, 100, 119, 35, 108, 118, 35, 104, 112, 101,
+    104, 103, 103, 104, 103, 35, 68, 76, 66, 35, 90, 107, 100, 119, 35, 108,
+    118, 35, 100, 35, 119, 117, 100, 113, 118, 105, 114, 117, 112, 104, 117, 35,
+    112, 114, 103, 104, 111, 66, 35, 75, 104, 111, 111, 114, 47, 35, 107, 114,
+    122, 35, 100, 117, 104, 35, 124, 114, 120, 66, 35, 90, 107, 100, 119, 35,
+    108, 118, 35, 100, 117, 119, 108, 105, 108, 102, 108, 100, 111, 35, 108, 113,
+    119, 104, 111, 111, 108, 106, 104, 113, 102, 104, 66, 35, 75, 114, 122, 35,
+    103, 114, 104, 118, 35, 103, 104, 104, 115, 35, 111, 104, 100, 117, 113, 108,
+    113, 106, 35, 122, 114, 117, 110, 66, 35, 90, 107, 100, 119, 35, 108, 118,
+    35, 103, 104, 104, 115, 35, 111, 104, 100, 117, 113, 108, 113, 106, 66, 35,
+    75, 114, 122, 35, 103, 114, 104, 118, 35, 102, 114, 112, 115, 120, 119, 104,
+    117, 35, 121, 108, 118, 108, 114, 113, 35, 122, 114, 117, 110, 66, 35, 90,
+    107, 100, 119, 35, 102, 100, 113, 35, 124, 114, 120, 35, 103, 114, 66,
+};
+
+static const PromptCacheRecord prompt_records[14] = {
+    { 0x1eafdee9u, 0, 38, "Hello, what can you tell me about AI?" },
+    { 0x6e878f13u, 38, 26, "What is machine learning?" },
+    { 0xd81a5934u, 64, 27, "How does embedded AI work?" },
+    { 0xfdd8b9f0u, 91, 29, "Tell me about ARM processors" },
+    { 0x4aad897au, 120, 12, "What is AI?" },
+    { 0xcd5634d1u, 132, 32, "How does machine learning work?" },
+    { 0xc6a81b7au, 164, 21, "What is embedded AI?" },
+    { 0xdc9dfe85u, 185, 29, "What is a transformer model?" },
+    { 0x30f6b98fu, 214, 20, "Hello, how are you?" },
+    { 0x6258d2ffu, 234, 33, "What is artificial intelligence?" },
+    { 0x54839a98u, 267, 29, "How does deep learning work?" },
+    { 0xe61e408au, 296, 23, "What is deep learning?" },
+    { 0x9cb074e7u, 319, 31, "How does computer vision work?" },
+    { 0xec45cb40u, 350, 17, "What can you do?" },
+};
+
+const PromptCacheTable prompt_cache_table = {
+    0x9c79c491u, 14, prompt_records, prompt_tokens
+};
@@ -0,0 +1,370 @@
+#include "quant.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+// ARM CMSIS-DSP optimized operations
+#ifdef ARM_MATH_CM55
+#include "arm_math.h"
+#endif
+
+void quantize_activation(QuantizedActivation* xq, const float* x, int n) {
+    // Find the largest magnitude for the symmetric scale
+    float max_abs = 0.0f;
+#ifdef ARM_MATH_CM55
+    uint32_t idx;
+    arm_absmax_f32(x, n, &max_abs, &idx);
+#else
+    for (int i = 0; i < n; i++) {
+        float a = x[i] < 0.0f ? -x[i] : x[i];
+        max_abs = fmaxf_custom(max_abs, a);
+    }
+#endif
+
+    if (max_abs == 0.0f) {
+        for (int i = 0; i < n; i++) {
+            xq->q[i] = 0;
+        }
+        xq->s = 0.0f;
+        return;
+    }
+
+    xq->s = max_abs / 127.0f;
+    float inv_s = 127.0f / max_abs;
+    for (int i = 0; i < n; i++) {
+        float v = x[i] * inv_s;
+        xq->q[i] = (int8_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+    }
+}
+
+static int32_t dot_q8(const int8_t* x, const int8_t* row, int n) {
+#ifdef ARM_MATH_CM55
+    // SMLAD on M4/M33, VMLADAV on Helium cores
+    q31_t dot;
+    arm_dot_prod_q7(x, row, n, &dot);
+    return dot;
+#else
+    int32_t acc = 0;
+    for (int j = 0; j < n; j++) {
+        acc += (int32_t)x[j] * (int32_t)row[j];
+    }
+    return acc;
+#endif
+}
+
+void matmul_q8(float* xout, const QuantizedActivation* xq, const QuantizedTensor* w,
+               int layer, int n, int d) {
+    // Per-layer slice of the int8 weights and their per-row scales
+    const int8_t* wq = (const int8_t*)w->data + (size_t)layer * d * n;
+    const float* ws = w->scale + (size_t)layer * d;
+
+    for (int i = 0; i < d; i++) {
+        int32_t acc = dot_q8(xq->q, wq + i * n, n);
+        xout[i] = (float)acc * ws[i] * xq->s;
+    }
+}
+
+#ifdef HUFFMAN_LUT_POOL_BYTES
+// Decode tables of all Huffman-coded layers, filled entry by entry at load
+static uint16_t huffman_luts[HUFFMAN_LUT_POOL_BYTES / sizeof(uint16_t)] NOINIT;
+#endif
+// Reused decode table and the code lengths it was last built from
+static uint16_t huffman_lut[HUFFMAN_LUT_ENTRIES] NOINIT;
+static uint8_t huffman_lut_lengths[256];
+static int huffman_lut_valid;
+// Decoded int8 rows waiting for their dot products
+static int8_t huffman_tile[HUFFMAN_TILE_BYTES] NOINIT;
+
+static int build_huffman_lut(uint16_t* lut, const uint8_t* lengths) {
+    // Kraft sum in units of one table entry: a complete prefix code covers
+    // every entry exactly once, so no index decodes to garbage
+    int count[HUFFMAN_MAX_BITS + 1] = { 0 };
+    uint32_t kraft = 0;
+    int n_used = 0;
+    int last = 0;
+    for (int sym = 0; sym < 256; sym++) {
+        int len = lengths[sym];
+        if (len > HUFFMAN_MAX_BITS) {
+            return -1;
+        }
+        if (len > 0) {
+            count[len]++;
+            kraft += 1u << (HUFFMAN_MAX_BITS - len);
+            n_used++;
+            last = sym;
+        }
+    }
+    if (n_used == 1 && kraft == HUFFMAN_LUT_ENTRIES / 2) {
+        // One distinct weight: the encoder gives it a 1-bit code
+        for (int e = 0; e < HUFFMAN_LUT_ENTRIES; e++) {
+            lut[e] = (uint16_t)(last | 1 << 8);
+        }
+        return 0;
+    }
+    if (kraft != HUFFMAN_LUT_ENTRIES) {
+        return -1;
+    }
+    
+    // Canonical code assignment (as in DEFLATE): shorter codes first,
+    // ties broken by symbol value
+    uint32_t next_code[HUFFMAN_MAX_BITS + 1];
+    uint32_t code = 0;
+    for (int len = 1; len <= HUFFMAN_MAX_BITS; len++) {
+        code = (code + count[len - 1]) << 1;
+        next_code[len] = code;
+    }
+    
+    // A code of length len owns 2^(MAX_BITS - len) consecutive entries
+    for (int sym = 0; sym < 256; sym++) {
+        int len = lengths[sym];
+        if (len == 0) {
+            continue;
+        }
+        uint32_t first = next_code[len]++ << (HUFFMAN_MAX_BITS - len);
+        uint32_t span = 1u << (HUFFMAN_MAX_BITS - len);
+        for (uint32_t e = 0; e < span; e++) {
+            lut[first + e] = (uint16_t)(sym | len << 8);
+        }
+    }
+    return 0;
+}
+
+int huffman_init(TransformerWeights* w, const Config* p) {
+    QuantizedTensor* tensors[] = { &w->wq_q, &w->wk_q, &w->wv_q, &w->wo_q, &w->w1_q, &w->w2_q, &w->w3_q, &w->wcls_q };
+    int n_tensors = (int)(sizeof(tensors) / sizeof(tensors[0]));
+    size_t needed = 0;
+    for (int t = 0; t < n_tensors; t++) {
+        QuantizedTensor* q = tensors[t];
+        if (!q->data) {
+            continue; // low-rank, or a classifier shared with the embedding
+        }
+        int layers = q == &w->wcls_q ? 1 : p->n_layers;
+        q->lut = NULL;
+        for (int l = 0; l < layers; l++) {
+            if (build_huffman_lut(huffman_lut, (const uint8_t*)q->codebook + (size_t)l * 256) != 0) {
+                printf("Huffman tensor %d layer %d: code lengths are not a complete prefix code\r\n", t, l);
+                return -1;
+            }
+        }
+        needed += (size_t)layers * HUFFMAN_LUT_ENTRIES;
+    }
+    huffman_lut_valid = 0;
+    
+#ifdef HUFFMAN_LUT_POOL_BYTES
+    // Every layer's table up front when the pool holds them all
+    if (needed <= sizeof(huffman_luts) / sizeof(huffman_luts[0])) {
+        size_t used = 0;
+        for (int t = 0; t < n_tensors; t++) {
+            QuantizedTensor* q = tensors[t];
+            if (!q->data) {
+                continue;
+            }
+            int layers = q == &w->wcls_q ? 1 : p->n_layers;
+            q->lut = huffman_luts + used;
+            for (int l = 0; l < layers; l++) {
+                build_huffman_lut(huffman_luts + used, (const uint8_t*)q->codebook + (size_t)l * 256);
+                used += HUFFMAN_LUT_ENTRIES;
+            }
+        }
+        printf("Huffman decode tables: %lu bytes\r\n", (unsigned long)(used * sizeof(uint16_t)));
+        return 0;
+    }
+    printf("Huffman decode tables (%lu bytes) exceed HUFFMAN_LUT_POOL_BYTES, building them per matmul\r\n",
+           (unsigned long)(needed * sizeof(uint16_t)));
+#else
+    (void)needed;
+#endif
+    return 0;
+}
+
+// Decode table for one layer's code lengths: from the pool, or the reused
+// table, rebuilt only when the lengths differ from the last ones. Lengths
+// are compared by content, so layers with the same code share one build.
+static const uint16_t* huffman_layer_lut(const QuantizedTensor* w, int layer) {
+    if (w->lut) {
+        return w->lut + (size_t)layer * HUFFMAN_LUT_ENTRIES;
+    }
+    const uint8_t* lengths = (const uint8_t*)w->codebook + (size_t)layer * 256;
+    if (!huffman_lut_valid || memcmp(huffman_lut_lengths, lengths, 256) != 0) {
+        build_huffman_lut(huffman_lut, lengths); // checked at load
+        memcpy(huffman_lut_lengths, lengths, 256);
+        huffman_lut_valid = 1;
+    }
+    return huffman_lut;
+}
+
+void matmul_q8_huffman(float* xout, const QuantizedActivation* xq, const QuantizedTensor* w,
+                       int layer, int n, int d) {
+    const uint8_t* src = (const uint8_t*)w->data + (size_t)layer * w->layer_bytes;
+    const uint8_t* end = src + w->layer_bytes;
+    const float* ws = w->scale + (size_t)layer * d;
+    const uint16_t* lut = huffman_layer_lut(w, layer);
+    
+    // MSB-first bit reader; past the end of the layer it shifts in zeros
+    uint64_t bits = 0;
+    int n_bits = 0;
+    int rows_per_tile = HUFFMAN_TILE_BYTES / n;
+    
+    for (int row0 = 0; row0 < d; row0 += rows_per_tile) {
+        int rows = d - row0 < rows_per_tile ? d - row0 : rows_per_tile;
+        
+        // Decode one tile of rows
+        for (int j = 0; j < rows * n; j++) {
+            while (n_bits <= 56) {
+                bits |= (uint64_t)(src < end ? *src++ : 0) << (56 - n_bits);
+                n_bits += 8;
+            }
+            uint16_t entry = lut[bits >> (64 - HUFFMAN_MAX_BITS)];
+            int len = entry >> 8;
+            huffman_tile[j] = (int8_t)(entry & 0xFF);
+            bits <<= len;
+            n_bits -= len;
+        }
+        
+        for (int i = 0; i < rows; i++) {
+            int32_t acc = dot_q8(xq->q, huffman_tile + i * n, n);
+            xout[row0 + i] = (float)acc * ws[row0 + i] * xq->s;
+        }
+    }
+}
+
+// Codebook centroids of the current layer, converted from fp16 once per call
+static float codebook_lut[256] NOINIT;
+// Per-centroid sums of x for the 4-bit bucket accumulation
+static float codebook_acc[16] NOINIT;
+
+static void load_codebook(const QuantizedTensor* w, int layer, int k) {
+    const uint16_t* cb = w->codebook + (size_t)layer * k;
+    for (int i = 0; i < k; i++) {
+        codebook_lut[i] = fp16_to_f32(cb[i]);
+    }
+}
+
+void matmul_codebook(float* xout, const float* x, const QuantizedTensor* w, int format,
+                     int layer, int n, int d) {
+    if (format == WEIGHT_FORMAT_CB4) {
+        // Two indices per byte, low nibble first. Each row first sums x into
+        // 16 buckets (adds only), then does 16 multiplies with the centroids.
+        const uint8_t* idx = (const uint8_t*)w->data + (size_t)layer * d * n / 2;
+        load_codebook(w, layer, 16);
+        for (int i = 0; i < d; i++) {
+            const uint8_t* row = idx + i * n / 2;
+            for (int k = 0; k < 16; k++) {
+                codebook_acc[k] = 0.0f;
+            }
+            for (int j = 0; j < n / 2; j++) {
+                codebook_acc[row[j] & 0x0F] += x[2 * j];
+                codebook_acc[row[j] >> 4] += x[2 * j + 1];
+            }
+            float val = 0.0f;
+            for (int k = 0; k < 16; k++) {
+                val += codebook_acc[k] * codebook_lut[k];
+            }
+            xout[i] = val;
+        }
+    } else {
+        // One index per byte, weights fetched straight from the 256-entry LUT
+        const uint8_t* idx = (const uint8_t*)w->data + (size_t)layer * d * n;
+        load_codebook(w, layer, 256);
+        for (int i = 0; i < d; i++) {
+            const uint8_t* row = idx + i * n;
+            float val = 0.0f;
+            for (int j = 0; j < n; j++) {
+                val += x[j] * codebook_lut[row[j]];
+            }
+            xout[i] = val;
+        }
+    }
+}
+
+void dequantize_codebook_row(float* out, const QuantizedTensor* w, int format, int row, int n) {
+    if (format == WEIGHT_FORMAT_CB4) {
+        const uint8_t* idx = (const uint8_t*)w->data + (size_t)row * n / 2;
+        load_codebook(w, 0, 16);
+        for (int j = 0; j < n / 2; j++) {
+            out[2 * j] = codebook_lut[idx[j] & 0x0F];
+            out[2 * j + 1] = codebook_lut[idx[j] >> 4];
+        }
+    } else {
+        const uint8_t* idx = (const uint8_t*)w->data + (size_t)row * n;
+        load_codebook(w, 0, 256);
+        for (int j = 0; j < n; j++) {
+            out[j] = codebook_lut[idx[j]];
+        }
+    }
+}
+
+// Sum of x over the set bits of mask
+static inline float masked_sum(const float* x, uint32_t mask) {
+    float acc = 0.0f;
+    while (mask) {
+        acc += x[__builtin_ctz(mask)];
+        mask &= mask - 1;
+    }
+    return acc;
+}
+
+void matmul_ternary(float* xout, const float* x, const QuantizedTensor* w, int layer, int n, int d) {
+    // Each row is n/32 (plus, minus) uint32 mask pairs
+    int groups = n / 32;
+    const uint32_t* masks = (const uint32_t*)w->data + (size_t)layer * d * groups * 2;
+    float scale = w->scale[layer];
+
+    for (int i = 0; i < d; i++) {
+        const uint32_t* row = masks + i * groups * 2;
+        float acc = 0.0f;
+        for (int g = 0; g < groups; g++) {
+            const float* xg = x + g * 32;
+            acc += masked_sum(xg, row[2 * g]);
+            acc -= masked_sum(xg, row[2 * g + 1]);
+        }
+        xout[i] = acc * scale;
+    }
+}
+
+void quantized_rows(QuantizedTensor* out, const QuantizedTensor* w, int format, int layer,
+                    int row0, int d, const void* data) {
+    *out = *w;
+    out->data = data;
+    switch (format) {
+        case WEIGHT_FORMAT_Q8:
+            out->scale = w->scale + (size_t)layer * d + row0;
+            break;
+        case WEIGHT_FORMAT_CB4:
+            out->codebook = w->codebook + (size_t)layer * 16;
+            break;
+        case WEIGHT_FORMAT_CB8:
+            out->codebook = w->codebook + (size_t)layer * 256;
+            break;
+        case WEIGHT_FORMAT_TERNARY:
+            out->scale = w->scale + layer;
+            break;
+    }
+}
+
+void prepare_activation(QuantizedActivation* xq, const float* x, int n, int format) {
+    if (format == WEIGHT_FORMAT_Q8 || format == WEIGHT_FORMAT_Q8_HUFFMAN) {
+        quantize_activation(xq, x, n);
+    }
+}
+
+void matmul_quantized(float* xout, const float* x, const QuantizedActivation* xq,
+                      const QuantizedTensor* w, int format, int layer, int n, int d) {
+    switch (format) {
+        case WEIGHT_FORMAT_Q8:
+            matmul_q8(xout, xq, w, layer, n, d);
+            break;
+        case WEIGHT_FORMAT_Q8_HUFFMAN:
+            matmul_q8_huffman(xout, xq, w, layer, n, d);
+            break;
+        case WEIGHT_FORMAT_CB4:
+        case WEIGHT_FORMAT_CB8:
+            matmul_codebook(xout, x, w, format, layer, n, d);
+            break;
+        case WEIGHT_FORMAT_TERNARY:
+            matmul_ternary(xout, x, w, layer, n, d);
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef QUANT_H
+#define QUANT_H
+
+#include "tinyllama2.h"
+
+// Quantize an activation vector to int8 with a symmetric per-token scale
+void quantize_activation(QuantizedActivation* xq, const float* x, int n);
+
+// W8A8 matmul: xout (d,) = w[layer] (d,n) @ xq (n,), int8 x int8 -> int32
+void matmul_q8(float* xout, const QuantizedActivation* xq, const QuantizedTensor* w,
+               int layer, int n, int d);
+
+// Codebook matmul: weights are indices into per-layer fp16 centroids (CB4/CB8)
+void matmul_codebook(float* xout, const float* x, const QuantizedTensor* w, int format,
+                     int layer, int n, int d);
+
+// Decode one row of a codebook tensor (token embedding lookup)
+void dequantize_codebook_row(float* out, const QuantizedTensor* w, int format, int row, int n);
+
+// Ternary matmul: per 32 weights, a +1 mask and a -1 mask (n multiple of 32).
+// Only adds and subtracts of x, one multiply by the tensor scale per row.
+void matmul_ternary(float* xout, const float* x, const QuantizedTensor* w, int layer, int n, int d);
+
+// Huffman-coded W8A8 matmul: each layer's int8 weights are one canonical
+// Huffman bitstream (code lengths in w->codebook). Rows are decoded a tile
+// at a time into a small SRAM buffer right before their dot products.
+// n must not exceed HUFFMAN_TILE_BYTES.
+#define HUFFMAN_MAX_BITS 11
+#define HUFFMAN_TILE_BYTES 4096
+void matmul_q8_huffman(float* xout, const QuantizedActivation* xq, const QuantizedTensor* w,
+                       int layer, int n, int d);
+
+// Decode table: entry = symbol | code length << 8, indexed by the next
+// HUFFMAN_MAX_BITS bits of the stream, 4 KB per tensor and layer. By default
+// one table is reused and rebuilt when a matmul brings other code lengths,
+// so RAM does not depend on the model's depth. Define HUFFMAN_LUT_POOL_BYTES
+// to build every layer's table once at load into a pool of that size; a
+// model whose tables do not fit falls back to the reused table.
+#define HUFFMAN_LUT_ENTRIES (1 << HUFFMAN_MAX_BITS)
+
+// Check the code lengths of w's Q8_HUFFMAN tensors and, with the pool,
+// build their decode tables (w->*_q.lut); -1 if a layer's code lengths are
+// not a complete prefix code
+int huffman_init(TransformerWeights* w, const Config* p);
+
+// Rows row0 .. of one layer of w, with their packed weights at data (a
+// streamed tile), as a one-layer tensor: scales and codebooks of that
+// layer and those rows are used in place. d is the layer's row count.
+void quantized_rows(QuantizedTensor* out, const QuantizedTensor* w, int format, int layer,
+                    int row0, int d, const void* data);
+
+// Prepare the projection input for a weight format (int8 for W8A8, no-op otherwise)
+void prepare_activation(QuantizedActivation* xq, const float* x, int n, int format);
+
+// Projection through a quantized tensor; x or xq is used depending on the format
+void matmul_quantized(float* xout, const float* x, const QuantizedActivation* xq,
+                      const QuantizedTensor* w, int format, int layer, int n, int d);
+
+#endif // QUANT_H
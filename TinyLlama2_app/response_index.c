@@ -0,0 +1,57 @@
+#include "response_index.h"
+
+// Child of s on byte c, 0 if none (the root is never a child)
+static uint32_t next_state(const ResponseIndex* index, uint32_t s, uint8_t c) {
+    uint32_t lo = index->first_edge[s];
+    uint32_t hi = index->first_edge[s + 1];
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (index->edge_byte[mid] < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < index->first_edge[s + 1] && index->edge_byte[lo] == c ? index->edge_next[lo] : 0;
+}
+
+int response_index_find(const ResponseIndex* index, const char* text, int len) {
+    if (index->n_states == 0) {
+        return -1;
+    }
+
+    // Every byte moves down one edge and up at most as many fail links as
+    // edges taken before, so the scan is O(len)
+    const uint8_t* p = (const uint8_t*)text;
+    uint32_t s = 0;
+    int best = -1;
+    for (int i = 0; i < len; i++) {
+        uint8_t c = p[i];
+        for (;;) {
+            if (s == 0) {
+                s = index->root[c];
+                break;
+            }
+            uint32_t next = next_state(index, s, c);
+            if (next) {
+                s = next;
+                break;
+            }
+            s = index->fail[s];
+        }
+
+        int m = index->match[s];
+        if (m >= 0 && (best < 0 || m < best)) {
+            best = m;
+            if (best == 0) {
+                break; // nothing ranks higher
+            }
+        }
+    }
+    return best;
+}
+
+const char* response_index_lookup(const ResponseIndex* index, const char* text, int len) {
+    int id = response_index_find(index, text, len);
+    return id >= 0 && id < index->n_responses ? index->responses[id] : index->fallback;
+}
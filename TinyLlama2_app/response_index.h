@@ -0,0 +1,42 @@
+#ifndef RESPONSE_INDEX_H
+#define RESPONSE_INDEX_H
+
+#include <stdint.h>
+
+// Canned-response matcher: every keyword of the demo's Q&A list compiled
+// at build time (scripts/build_response_index.py, from
+// scripts/qa_responses.txt) into one Aho-Corasick automaton in flash. A
+// question is scanned once, whatever the number of keywords, and the
+// response listed first among all the keywords it contains wins.
+//
+// Each state is a keyword prefix. Its edges go to the longer prefixes,
+// sorted by byte (the root has a full 256-entry table instead, it is where
+// a scan spends most of its time), and its fail link goes to the longest
+// proper suffix that is also a prefix. match[] is folded along the fail
+// links at build time, so a state knows the best response of every
+// keyword ending there.
+
+typedef struct {
+    int n_states;
+    int n_responses;
+    const uint32_t* root;        // [256] state after the root, 0 for no edge
+    const uint32_t* first_edge;  // [n_states + 1] edges of s: first_edge[s] .. first_edge[s + 1] - 1
+    const uint8_t* edge_byte;    // per state, ascending
+    const uint32_t* edge_next;
+    const uint32_t* fail;        // [n_states]
+    const int16_t* match;        // [n_states] lowest response id ending here, -1 for none
+    const char* const* responses; // [n_responses], in priority order
+    const char* fallback;        // when no keyword occurs
+} ResponseIndex;
+
+// Generated response_index_data.c
+extern const ResponseIndex response_index;
+
+// Scan len bytes of lowercase text; returns the winning response id, -1
+// if no keyword occurs
+int response_index_find(const ResponseIndex* index, const char* text, int len);
+
+// Response text for lowercase text, the fallback when nothing matches
+const char* response_index_lookup(const ResponseIndex* index, const char* text, int len);
+
+#endif // RESPONSE_INDEX_H
@@ -0,0 +1,98 @@
+// TinyLlama2 canned-response keyword index
+// Generated automatically by scripts/build_response_index.py
+
+#include "response_index.h"
+
+static const uint32_t index_root[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 0, 105, 33, 8, 0, 0, 65, 0, 0, 0, 3, 50, 27, 0,
+    0, 0, 0, 0, 18, 0, 37, 90, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const uint32_t index_first_edge[118] = {
+    0, 0, 2, 2, 4, 5, 6, 7, 7, 8, 9, 10, 11, 12, 13, 14,
+    14, 15, 15, 16, 17, 18, 19, 20, 21, 22, 23, 23, 24, 25, 26, 27,
+    28, 28, 29, 30, 31, 31, 32, 33, 34, 35, 36, 36, 37, 38, 39, 40,
+    41, 42, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+    56, 56, 59, 60, 61, 62, 62, 62, 63, 64, 66, 67, 68, 69, 70, 71,
+    72, 72, 73, 74, 75, 76, 77, 78, 79, 80, 80, 81, 82, 83, 84, 85,
+    86, 87, 88, 89, 90, 91, 92, 93, 94, 94, 95, 96, 97, 98, 99, 100,
+    101, 102, 103, 104, 105, 105,
+};
+
+static const uint8_t index_edge_byte[105] = {
+    105, 114, 97, 101, 97, 114, 110, 109, 98, 101, 100, 100, 101, 100, 109, 114,
+    97, 110, 115, 102, 111, 114, 109, 101, 117, 114, 97, 108, 101, 101, 112, 105,
+    115, 105, 111, 110, 110, 103, 117, 97, 103, 101, 105, 99, 114, 111, 99, 111,
+    110, 116, 114, 111, 108, 108, 101, 114, 101, 105, 111, 108, 108, 111, 119, 32,
+    97, 100, 114, 101, 32, 121, 111, 117, 111, 32, 121, 111, 117, 32, 100, 111,
+    104, 97, 116, 32, 99, 97, 110, 32, 121, 111, 117, 32, 100, 111, 97, 112,
+    97, 98, 105, 108, 105, 116, 105, 101, 115,
+};
+
+static const uint32_t index_edge_next[105] = {
+    2, 16, 43, 4, 5, 6, 7, 9, 10, 11, 12, 13, 14, 15, 17, 19,
+    20, 21, 22, 23, 24, 25, 26, 28, 29, 30, 31, 32, 34, 35, 36, 38,
+    39, 40, 41, 42, 44, 45, 46, 47, 48, 49, 51, 52, 53, 54, 55, 56,
+    57, 58, 59, 60, 61, 62, 63, 64, 66, 70, 71, 67, 68, 69, 72, 73,
+    74, 81, 75, 76, 77, 78, 79, 80, 82, 83, 84, 85, 86, 87, 88, 89,
+    91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 106, 107,
+    108, 109, 110, 111, 112, 113, 114, 115, 116,
+};
+
+static const uint32_t index_fail[117] = {
+    0, 0, 0, 0, 8, 1, 16, 27, 0, 50, 0, 8, 33, 33, 34, 33,
+    0, 50, 0, 0, 1, 27, 0, 0, 0, 0, 50, 0, 8, 0, 0, 1,
+    3, 0, 8, 8, 0, 0, 0, 0, 0, 0, 27, 1, 27, 0, 0, 1,
+    0, 8, 0, 0, 105, 0, 0, 105, 0, 27, 18, 19, 0, 3, 3, 4,
+    0, 0, 8, 3, 3, 0, 0, 0, 90, 0, 1, 16, 8, 0, 0, 0,
+    0, 33, 0, 0, 0, 0, 0, 0, 33, 0, 0, 65, 1, 18, 0, 105,
+    106, 27, 0, 0, 0, 0, 0, 33, 0, 0, 1, 0, 1, 0, 0, 3,
+    0, 18, 0, 8, 0,
+};
+
+static const int16_t index_match[117] = {
+    -1, -1, 0, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1, -1, -1, 2,
+    -1, 3, -1, -1, -1, -1, -1, -1, -1, -1, 4, -1, -1, -1, -1, -1,
+    5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7, -1, -1, -1, -1, -1,
+    -1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    9, -1, -1, -1, -1, 10, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    11, -1, -1, -1, -1, -1, -1, -1, -1, 11, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, 12, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, 12,
+};
+
+static const char* const index_responses[13] = {
+    "AI is artificial intelligence that enables machines to simulate human thinking and decision-making processes.",
+    "Machine learning uses algorithms to find patterns in data and make predictions without explicit programming.",
+    "Embedded AI runs machine learning models directly on microcontrollers and small devices for real-time processing.",
+    "ARM processors are energy-efficient chips used in smartphones, IoT devices, and embedded systems worldwide.",
+    "Transformers use attention mechanisms to process sequences of data, revolutionizing natural language processing.",
+    "Neural networks learn by adjusting connection weights between neurons based on training data and feedback.",
+    "Deep learning uses multi-layered neural networks to automatically learn complex patterns from large datasets.",
+    "Computer vision enables machines to interpret and understand visual information from images and videos.",
+    "NLP helps computers understand, interpret, and generate human language in a meaningful way.",
+    "This ARM Cortex-M85 runs at high efficiency with dedicated AI acceleration for edge computing applications.",
+    "Hello! I'm TinyLlama2 running on ARM Cortex-M85. Ask me about AI, machine learning, or embedded systems!",
+    "I'm running efficiently on this microcontroller! My neural networks are processing at optimal performance.",
+    "I can answer questions about AI, explain machine learning concepts, and demonstrate edge computing capabilities!",
+};
+
+const ResponseIndex response_index = {
+    117, 13,
+    index_root, index_first_edge, index_edge_byte, index_edge_next, index_fail, index_match,
+    index_responses, "I'm a specialized AI model focused on embedded systems and machine learning. Try asking about AI, neural networks, or ARM processors!"
+};
@@ -1,61 +1,331 @@
+// madvise() and MAP_/MADV_ flags beyond POSIX, also under -std=c11
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "tinyllama2.h"
 #include "transformer.h"
 #include "utils.h"
+#include "model_blob.h"
+#include "weight_stream.h"
+#include "boot_time.h"
+#include "tokenizer.h"
+#include "kv_cache.h"
+#include "kv_snapshot.h"
+#include "lora.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Simplified memory-mapped model loading for embedded systems
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+// Host builds: map a raw blob written by extract_weights.py --bin. The file
+// is used in place through the page cache, so loading does no parsing or
+// copying, processes running the same model share its pages, and startup
+// does not grow with model size (pages fault in on first use).
+// MODEL_MMAP_POPULATE prefaults the whole file instead; MODEL_MMAP_HUGEPAGES
+// asks for transparent huge pages (needs THP for page-cache files).
+static int map_checkpoint(Transformer* t, const char* checkpoint_path) {
+    int fd = open(checkpoint_path, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open %s\r\n", checkpoint_path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ModelBlobHeader)) {
+        printf("%s is not a model blob\r\n", checkpoint_path);
+        close(fd);
+        return -1;
+    }
+    
+    int flags = MAP_SHARED;
+#if defined(MODEL_MMAP_POPULATE) && defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;
+#endif
+    void* data = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+    if (data == MAP_FAILED) {
+        printf("Cannot map %s\r\n", checkpoint_path);
+        close(fd);
+        return -1;
+    }
+    
+    // Start readahead without waiting for it
+    madvise(data, st.st_size, MADV_WILLNEED);
+#if defined(MODEL_MMAP_HUGEPAGES) && defined(MADV_HUGEPAGE)
+    madvise(data, st.st_size, MADV_HUGEPAGE);
+#endif
+    
+    const ModelBlobHeader* h = (const ModelBlobHeader*)data;
+    if (h->total_size > (size_t)st.st_size) {
+        printf("%s is truncated (%lu of %lu bytes)\r\n", checkpoint_path,
+               (unsigned long)st.st_size, (unsigned long)h->total_size);
+        munmap(data, st.st_size);
+        close(fd);
+        return -1;
+    }
+    t->fd = fd;
+    t->data = (float*)data;
+    t->file_size = st.st_size;
+    return 0;
+}
+#endif
+
+// Memory-mapped model loading: the blob is used in place, either the one
+// linked into the firmware or, on the host, a mapped checkpoint file
 int build_transformer(Transformer* t, const char* checkpoint_path) {
-    // Initialize config with TinyLlama2 parameters
-    t->config.dim = DIM;
-    t->config.hidden_dim = HIDDEN_DIM;
-    t->config.n_layers = N_LAYERS;
-    t->config.n_heads = N_HEADS;
-    t->config.n_kv_heads = N_KV_HEADS;
-    t->config.vocab_size = VOCAB_SIZE;
-    t->config.seq_len = MAX_SEQ_LEN;
-    
-    // For embedded demo, we'll use placeholder weights
-    // In production, these would be loaded from flash memory
+    t->fd = -1;
+    t->data = (float*)model_blob;
+    t->file_size = ((const ModelBlobHeader*)model_blob)->total_size;
+    if (checkpoint_path) {
+#if defined(__linux__)
+        if (map_checkpoint(t, checkpoint_path) != 0) {
+            return -1;
+        }
+        printf("Model blob mapped from %s\r\n", checkpoint_path);
+#else
+        printf("No file system: ignoring %s, using the linked-in model\r\n", checkpoint_path);
+#endif
+    }
+    const uint8_t* blob = (const uint8_t*)t->data;
+    
+    // Config comes from the header of the model blob
     printf("Loading model configuration...\r\n");
+    if (read_model_config(&t->config, blob) != 0) {
+        return -1;
+    }
     printf("- Vocabulary size: %d\r\n", t->config.vocab_size);
     printf("- Model dimension: %d\r\n", t->config.dim);
     printf("- Number of layers: %d\r\n", t->config.n_layers);
-    printf("- Number of heads: %d\r\n", t->config.n_heads);
+    printf("- Number of heads: %d (%d KV)\r\n", t->config.n_heads, t->config.n_kv_heads);
+    printf("- Hidden dimension: %d\r\n", t->config.hidden_dim);
+    static const char* const format_names[] = { "FP32", "W8A8", "CB4", "CB8", "TERNARY", "W8A8+HUFFMAN" };
+    printf("- Weight format: %s\r\n", format_names[t->config.weight_format]);
+    if (t->config.lowrank_rank > 0) {
+        printf("- Low-rank wo/w2/wcls: rank %d\r\n", t->config.lowrank_rank);
+    }
+    // Shape dispatch is resolved here, not on every kernel call
+    printf("- Kernels: %s\r\n", transformer_select_kernels(&t->config) ? "fixed-shape" : "runtime-sized");
+    boot_mark("model config");
+    
+    // Weights are used in place from the blob
+    if (memory_map_weights(&t->weights, &t->config, blob) != 0) {
+        return -1;
+    }
+    boot_mark("weight map");
+    
+#ifdef MODEL_STREAM_WEIGHTS
+    // Blob lives in slow memory: stream the projections through ISRAM tiles
+    static WeightStream stream;
+    if (weight_stream_init(&stream, &t->weights, &t->config, blob) != 0) {
+        return -1;
+    }
+    boot_mark("weight stream");
+#endif
+    
+    // Task adapters over the shared base weights, sized into the run state
+    lora_init(&t->config);
     
     // Allocate memory for runtime state
-    malloc_run_state(&t->state, &t->config);
+    if (malloc_run_state(&t->state, &t->config) != 0) {
+        return -1;
+    }
+    boot_mark("run state");
     
     return 0; // Success
 }
 
 void free_transformer(Transformer* t) {
     free_run_state(&t->state);
+#if defined(__linux__)
+    if (t->fd >= 0) {
+        munmap(t->data, t->file_size);
+        close(t->fd);
+        t->fd = -1;
+    }
+#endif
+}
+
+// Token ids of SYSTEM_PROMPT, for sessions that cannot share its KV
+static int prompt_tokens[sizeof(SYSTEM_PROMPT) + 2];
+
+int prefill(Transformer* t, const int* tokens, int n_tokens, int pos) {
+    for (int i = 0; i < n_tokens; i++, pos++) {
+        if (!forward(t, tokens[i], pos)) {
+            return -1;
+        }
+    }
+    return pos;
 }
 
-void generate(Transformer* transformer, int* prompt, int steps, float temperature) {
-    printf("Generating %d tokens with temperature %.2f\r\n", steps, temperature);
+// Run the system prompt through the model into s->kv from position 0
+static int prefill_prompt(Transformer* t) {
+    RunState* s = &t->state;
+    kv_seq_truncate(s->kv, 0);
+    if (prefill(t, prompt_tokens, s->prompt_len, 0) < 0) {
+        kv_seq_truncate(s->kv, 0);
+        return -1;
+    }
+    return 0;
+}
+
+int load_system_prompt(Transformer* t, Tokenizer* tokenizer) {
+    RunState* s = &t->state;
+    encode(tokenizer, SYSTEM_PROMPT, 1, 0, prompt_tokens, &s->prompt_len);
     
-    // Simplified generation loop for demo
-    for (int step = 0; step < steps; step++) {
-        // In real implementation, this would:
-        // 1. Run transformer forward pass
-        // 2. Apply temperature scaling
-        // 3. Sample next token
-        // 4. Add to sequence
+    // The build-time snapshot replaces the prefill when it matches this model
+    int n_pos = kv_snapshot_load(s->prompt_kv, &t->config, kv_snapshot, (const uint8_t*)t->data,
+                                 prompt_tokens, s->prompt_len);
+    if (n_pos == s->prompt_len) {
+        printf("System prompt: %d positions from the KV snapshot\r\n", n_pos);
+        return 0;
+    }
+    
+    // No usable snapshot: prefill once here with the base weights,
+    // sessions still share the result
+    KVSequence* kv = s->kv;
+    s->kv = s->prompt_kv;
+    s->lora = NULL;
+    int status = prefill_prompt(t);
+    s->kv = kv;
+    if (status != 0) {
+        return -1;
+    }
+    printf("System prompt: %d positions prefilled\r\n", s->prompt_len);
+    return 0;
+}
+
+int start_session(Transformer* t, const LoraAdapter* adapter) {
+    RunState* s = &t->state;
+    s->lora = adapter;
+    
+    // An adapter changes every layer's keys and values, so the shared
+    // base-model prompt KV does not apply: prefill it for this session
+    if (adapter) {
+        return prefill_prompt(t) == 0 ? s->prompt_len : -1;
+    }
+    
+    // A base-model session shares the system prompt blocks; the first write
+    // into the last, partly filled one copies it (kv_seq_reserve)
+    kv_seq_truncate(s->kv, 0);
+    kv_seq_fork(s->kv, s->prompt_kv);
+    return s->prompt_len;
+}
+
+int resume_session(Transformer* t, const KVSequence* kv, int n_pos) {
+    RunState* s = &t->state;
+    s->lora = NULL;
+    kv_seq_truncate(s->kv, 0);
+    kv_seq_fork(s->kv, kv);
+    return n_pos;
+}
+
+// Draw from a probability distribution; coin in [0, 1)
+static int sample_mult(const float* probabilities, int n, float coin) {
+    float cdf = 0.0f;
+    for (int i = 0; i < n; i++) {
+        cdf += probabilities[i];
+        if (coin < cdf) {
+            return i;
+        }
+    }
+    return n - 1; // rounding
+}
+
+static int sample_token(float* logits, int n, float temperature, unsigned long long* rng) {
+    if (temperature <= 0.0f) {
+        return sample(logits, n);
+    }
+    for (int i = 0; i < n; i++) {
+        logits[i] /= temperature;
+    }
+    softmax(logits, n);
+    return sample_mult(logits, n, random_f32(rng));
+}
+
+int generate(Transformer* t, Tokenizer* tokenizer, const int* prompt, int n_prompt, int pos,
+             const GenerateConfig* cfg, GenerateStats* stats) {
+    int vocab_size = t->config.vocab_size;
+    int seq_len = t->config.seq_len;
+    memset(stats, 0, sizeof(*stats));
+    stats->stop = GENERATE_STOP_MAX_TOKENS;
+    if (n_prompt < 1 || pos < 0 || pos + n_prompt > seq_len) {
+        return -1;
+    }
+    
+    // The prompt's last token gives the logits of the first new one
+    uint32_t start = boot_cycles();
+    pos = prefill(t, prompt, n_prompt - 1, pos);
+    float* logits = pos < 0 ? NULL : forward(t, prompt[n_prompt - 1], pos);
+    if (!logits) {
+        return -1;
+    }
+    pos++;
+    stats->n_prompt = n_prompt;
+    uint32_t decode_start = boot_cycles();
+    stats->prefill_cycles = decode_start - start;
+    
+    static char text[DETOKENIZER_MAX_OUTPUT];
+    Detokenizer detokenizer;
+    detokenizer_init(&detokenizer);
+    unsigned long long rng = cfg->seed;
+    for (int n = 0; n < cfg->max_tokens; n++) {
+        int token = sample_token(logits, vocab_size, cfg->temperature, &rng);
+        if (token == TOKEN_EOS || token == TOKEN_BOS) {
+            stats->stop = GENERATE_STOP_EOS;
+            break;
+        }
         
-        printf("Step %d: Processing...\r\n", step + 1);
+        detokenizer_push(&detokenizer, tokenizer, token, text, sizeof(text));
+        stats->n_generated++;
+        if (cfg->on_token && cfg->on_token(token, text, cfg->user)) {
+            stats->stop = GENERATE_STOP_CALLBACK;
+            break;
+        }
         
-        // Simulate processing delay
-        for (volatile int i = 0; i < 50000; i++);
+        // The last token is only run through the model when another follows
+        if (n + 1 == cfg->max_tokens) {
+            break;
+        }
+        if (pos >= seq_len) {
+            stats->stop = GENERATE_STOP_CONTEXT;
+            break;
+        }
+        logits = forward(t, token, pos);
+        if (!logits) {
+            stats->stop = GENERATE_STOP_ERROR;
+            break;
+        }
+        pos++;
+        stats->n_decoded++;
     }
+    stats->decode_cycles = boot_cycles() - decode_start;
     
-    printf("Generation complete!\r\n");
+    // Bytes of a character the output stopped in the middle of
+    detokenizer_flush(&detokenizer, text, sizeof(text));
+    if (text[0] != '\0' && cfg->on_token) {
+        cfg->on_token(-1, text, cfg->user);
+    }
+    return pos;
+}
+
+void generate_report(const GenerateStats* stats) {
+    static const char* const stop_names[] = { "token limit", "EOS", "stopped", "context full", "KV cache pool exhausted" };
+    unsigned long prefill_us = boot_cycles_to_us(stats->prefill_cycles);
+    unsigned long decode_us = boot_cycles_to_us(stats->decode_cycles);
+    printf("   Prefill: %d tokens in %lu us (%.1f tok/s)\r\n", stats->n_prompt, prefill_us,
+           prefill_us > 0 ? stats->n_prompt * 1e6f / prefill_us : 0.0f);
+    printf("   Decode: %d tokens in %lu us (%.1f tok/s), %s\r\n", stats->n_decoded, decode_us,
+           decode_us > 0 ? stats->n_decoded * 1e6f / decode_us : 0.0f, stop_names[stats->stop]);
 }
 
 int sample(float* probabilities, int n) {
-    // Simple argmax sampling for demo
+    // Greedy: the most likely token
     int max_idx = 0;
     float max_val = probabilities[0];
     
@@ -69,7 +339,7 @@ int sample(float* probabilities, int n) {
     return max_idx;
 }
 
-void softmax(float* x, int size) {
+ITCM_CODE void softmax(float* x, int size) {
     // Find max for numerical stability
     float max_val = x[0];
     for (int i = 1; i < size; i++) {
@@ -4,7 +4,9 @@
 #include <stdint.h>
 #include <stddef.h>
 
-// Model configuration (reduced for embedded demo)
+// Model configuration (reduced for embedded demo). The runtime Config is
+// read from the model blob header; these describe the built-in demo model
+// and select the shape-specialized kernels.
 #define VOCAB_SIZE 1000        // Reduced from 32000
 #define MAX_SEQ_LEN 64         // Reduced from 512
 #define DIM 64                 // Reduced from 288
@@ -13,6 +15,70 @@
 #define N_KV_HEADS 4           // Reduced from 6
 #define HEAD_SIZE (DIM / N_HEADS)
 #define HIDDEN_DIM 128         // Reduced from 768
+#define KV_DIM (DIM * N_KV_HEADS / N_HEADS)
+
+// Weight storage formats for the projection matrices
+#define WEIGHT_FORMAT_F32 0    // fp32 weights, fp32 activations
+#define WEIGHT_FORMAT_Q8  1    // W8A8: int8 per-row weights, int8 per-token activations
+#define WEIGHT_FORMAT_CB4 2    // 4-bit indices into 16 fp16 centroids per tensor
+#define WEIGHT_FORMAT_CB8 3    // 8-bit indices into 256 fp16 centroids per tensor
+#define WEIGHT_FORMAT_TERNARY 4 // {-1, 0, +1} bitplanes, one scale per tensor
+#define WEIGHT_FORMAT_Q8_HUFFMAN 5 // W8A8 with the int8 weights Huffman-coded per layer
+
+// Budget of each of the DTCM_BANKS arenas holding the activation buffers
+// (one DTCM bank by default)
+#ifndef RUN_STATE_BANK_BYTES
+#define RUN_STATE_BANK_BYTES DTCM_BANK_SIZE
+#endif
+
+// Where arena n lives: DTCM_BANK(n), or empty for plain SRAM .bss
+#ifndef RUN_STATE_BANK_PLACEMENT
+#define RUN_STATE_BANK_PLACEMENT(bank) DTCM_BANK(bank)
+#endif
+
+// Size of the KV cache block pool; seq_len is clamped to what fits. Twice
+// a full context, so a session has room beside the shared system prompt
+// and the KV the prompt cache keeps for earlier questions
+#ifndef KV_CACHE_POOL_BYTES
+#define KV_CACHE_POOL_BYTES (2 * N_LAYERS * 2 * MAX_SEQ_LEN * KV_DIM * sizeof(float))
+#endif
+
+// Quantized projection matrix, all layers stored back to back
+typedef struct {
+    const void* data;     // packed weights, layout depends on the weight format
+    const float* scale;   // dequantization scales (Q8: one per output row, ternary: one per layer)
+    const uint16_t* codebook; // fp16 centroids, one codebook per layer (CB4/CB8);
+                              // Huffman code lengths, 256 bytes per layer (Q8_HUFFMAN)
+    uint32_t layer_bytes; // stride of one layer in data (variable-length formats pad to it)
+    const uint16_t* lut;  // Huffman decode tables, one per layer, built at load (Q8_HUFFMAN pool), or NULL
+} QuantizedTensor;
+
+// Activation vector quantized to int8 with a dynamic per-token scale
+typedef struct {
+    int8_t* q;            // quantized values (max(dim, hidden_dim),)
+    float s;              // scale: x[i] ~= q[i] * s
+} QuantizedActivation;
+
+// Memory placement, see the ITCM/DTCM sections in gcc_linker_script.ld.src.
+// Hot kernels run from ITCM; the activation arenas live one per DTCM bank,
+// which is not zeroed at startup.
+#if defined(__ARM_ARCH) && !defined(TINYLLAMA2_NO_TCM)
+#define ITCM_CODE        __attribute__((section(".itcm_text")))
+#define DTCM_BANK(bank)  __attribute__((section(".dtcm" #bank ".bss")))
+#else
+#define ITCM_CODE
+#define DTCM_BANK(bank)
+#endif
+
+// Scratch that is always written before it is read: skipped by the
+// startup zeroing so it costs nothing at boot (.noinit in RAM0)
+#if defined(__ARM_ARCH)
+#define NOINIT           __attribute__((section(".noinit")))
+#else
+#define NOINIT
+#endif
+#define DTCM_BANKS 4
+#define DTCM_BANK_SIZE 0x2000
 
 // Model weights structure
 typedef struct {
@@ -27,7 +93,26 @@ typedef struct {
     float* w2;                      // (layer, dim, hidden_dim)
     float* w3;                      // (layer, hidden_dim, dim)
     float* rms_final_weight;        // (dim,)
-    float* wcls;                    // (vocab_size, dim)
+    float* wcls;                    // (vocab_size, dim), also set when a quantized model shares its fp32 embedding
+    // Quantized projections, used when config.weight_format != WEIGHT_FORMAT_F32
+    QuantizedTensor token_embedding_q; // codebook formats only
+    QuantizedTensor wq_q;
+    QuantizedTensor wk_q;
+    QuantizedTensor wv_q;
+    QuantizedTensor wo_q;
+    QuantizedTensor w1_q;
+    QuantizedTensor w2_q;
+    QuantizedTensor w3_q;
+    QuantizedTensor wcls_q;
+    // Low-rank factors W ~= U @ V, NULL when the projection is dense
+    float* wo_u;                    // (layer, dim, rank)
+    float* wo_v;                    // (layer, rank, dim)
+    float* w2_u;                    // (layer, dim, rank)
+    float* w2_v;                    // (layer, rank, hidden_dim)
+    float* wcls_u;                  // (vocab_size, rank)
+    float* wcls_v;                  // (rank, dim)
+    // Non-NULL when per-layer weights are streamed into ISRAM (weight_stream.h)
+    struct WeightStream* stream;
 } TransformerWeights;
 
 // Model configuration structure
@@ -39,22 +124,37 @@ typedef struct {
     int n_kv_heads;
     int vocab_size;
     int seq_len;
+    int weight_format; // WEIGHT_FORMAT_* of the projection matrices
+    int lowrank_rank;  // rank of the factored projections, 0 if none
+    float rope_theta;  // rotary position embedding base
 } Config;
 
-// Runtime state
+// Key/value width: n_kv_heads * head_size
+#define CONFIG_KV_DIM(p) ((p)->dim * (p)->n_kv_heads / (p)->n_heads)
+
+// Runtime state. The activation buffers alias each other where their
+// lifetimes allow (memory_plan.h): logits is only valid until the next forward().
 typedef struct {
     float* x;      // activation at current time stamp (dim,)
     float* xb;     // same, but inside a residual branch (dim,)
-    float* xb2;    // an additional buffer just for convenience (dim,)
+    float* xb2;    // attention output, one value slice per query head (dim,)
     float* hb;     // buffer for hidden dimension in the ffn (hidden_dim,)
     float* hb2;    // buffer for hidden dimension in the ffn (hidden_dim,)
     float* q;      // query (dim,)
-    float* k;      // key (dim,)
-    float* v;      // value (dim,)
+    float* k;      // key (kv_dim,), points into the KV cache at the current position
+    float* v;      // value (kv_dim,), points into the KV cache at the current position
     float* att;    // buffer for scores/attention values (n_heads, seq_len)
+    float* rope;   // cos then sin of each rotary frequency at the current position (head_size,)
     float* logits; // output logits
-    float* key_cache;   // (layer, seq_len, dim)
-    float* value_cache; // (layer, seq_len, dim)
+    QuantizedActivation xq; // int8 copy of the current projection input (W8A8)
+    float* lr;     // low-rank intermediate V @ x (lowrank_rank,)
+    float* lora_tmp; // LoRA intermediate A @ x (largest adapter rank,)
+    const struct LoraAdapter* lora; // adapter of the current session, NULL for the base model
+    struct KVPool* kv_pool;  // shared pool of KV cache blocks (kv_cache.h)
+    struct KVSequence* kv;   // block table of the sequence being decoded
+    struct KVSequence* prompt_kv; // system prompt KV, forked by every session
+    int prompt_len;               // positions in prompt_kv
+    struct MemoryPlan* plan; // buffer lifetimes, checked under RUN_STATE_PLAN_CHECK
 } RunState;
 
 // Main transformer structure
@@ -62,15 +162,60 @@ typedef struct {
     Config config;
     TransformerWeights weights;
     RunState state;
-    int fd;  // file descriptor for memory mapped weights
-    float* data; // memory mapped data pointer
+    int fd;  // file descriptor of the mapped checkpoint, -1 for the linked-in blob
+    float* data; // model blob in use (mapped checkpoint or linked-in model_blob)
     size_t file_size;
 } Transformer;
 
+// Called with every generated token and its text (whole UTF-8 characters,
+// may be empty while one is incomplete); nonzero stops the generation.
+// A last call with token -1 carries the bytes of a character left unfinished
+typedef int (*TokenCallback)(int token, const char* text, void* user);
+
+typedef struct {
+    int max_tokens;          // generated tokens at most
+    float temperature;       // 0 for greedy (argmax) decoding
+    unsigned long long seed; // sampling RNG state, used when temperature > 0
+    TokenCallback on_token;  // may be NULL
+    void* user;              // passed to on_token
+} GenerateConfig;
+
+// Why generate() stopped
+#define GENERATE_STOP_MAX_TOKENS 0
+#define GENERATE_STOP_EOS        1
+#define GENERATE_STOP_CALLBACK   2
+#define GENERATE_STOP_CONTEXT    3  // seq_len reached
+#define GENERATE_STOP_ERROR      4  // forward() failed (KV cache pool exhausted)
+
+typedef struct {
+    int n_prompt;            // prompt tokens prefilled
+    int n_generated;         // tokens passed to on_token
+    int n_decoded;           // forward() steps after the prompt
+    int stop;                // GENERATE_STOP_*
+    uint32_t prefill_cycles; // prompt through the model
+    uint32_t decode_cycles;  // sampling and every forward() after the prompt
+} GenerateStats;
+
 // Function declarations
+struct Tokenizer;
+struct LoraAdapter;
+struct KVSequence;
 int build_transformer(Transformer* t, const char* checkpoint_path);
 void free_transformer(Transformer* t);
-void generate(Transformer* transformer, int* prompt, int steps, float temperature);
+int load_system_prompt(Transformer* t, struct Tokenizer* tokenizer);
+int start_session(Transformer* t, const struct LoraAdapter* adapter);
+// Continue a base-model session from a KV cache of n_pos positions (shared,
+// not copied); returns n_pos
+int resume_session(Transformer* t, const struct KVSequence* kv, int n_pos);
+// Run tokens through the model from pos; returns the next position, -1 on failure
+int prefill(Transformer* t, const int* tokens, int n_tokens, int pos);
+// Prefill prompt from pos, then decode one token at a time until EOS, the
+// token limit, the end of the context or the callback stops it. Returns
+// the next position, -1 if the prompt could not be prefilled
+int generate(Transformer* t, struct Tokenizer* tokenizer, const int* prompt, int n_prompt, int pos,
+             const GenerateConfig* cfg, GenerateStats* stats);
+// Print prefill and decode throughput of a generate() call
+void generate_report(const GenerateStats* stats);
 int sample(float* probabilities, int n);
 void softmax(float* x, int size);
 
@@ -1,85 +1,551 @@
 #include "tokenizer.h"
+#include "pretokenize.h"
+#include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-int build_tokenizer(Tokenizer* t, const char* tokenizer_path, int vocab_size) {
-    // Initialize tokenizer with basic vocabulary
-    t->vocab_size = vocab_size;
-    t->max_token_length = 64;
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// "\x00\0", "\x01\0", ... "\xff\0": every single-byte string, built by the
+// preprocessor so it sits in flash instead of being filled at boot
+#define BYTE_PIECE(i)      (unsigned char)(i), 0
+#define BYTE_PIECES4(i)    BYTE_PIECE(i), BYTE_PIECE(i + 1), BYTE_PIECE(i + 2), BYTE_PIECE(i + 3)
+#define BYTE_PIECES16(i)   BYTE_PIECES4(i), BYTE_PIECES4(i + 4), BYTE_PIECES4(i + 8), BYTE_PIECES4(i + 12)
+#define BYTE_PIECES64(i)   BYTE_PIECES16(i), BYTE_PIECES16(i + 16), BYTE_PIECES16(i + 32), BYTE_PIECES16(i + 48)
+
+// Byte-level vocabulary for when no tokenizer blob is available: the pool
+// is the specials followed by the single-byte strings
+#define BYTE_VOCAB_SIZE (TOKEN_BYTE_BASE + 256)
+#define BYTE_VOCAB_SPECIALS "<unk>\0\n<s>\n\0\n</s>\n"
+
+static const struct {
+    char specials[sizeof(BYTE_VOCAB_SPECIALS)];
+    unsigned char bytes[256 * 2];
+} byte_vocab = {
+    BYTE_VOCAB_SPECIALS,
+    { BYTE_PIECES64(0), BYTE_PIECES64(64), BYTE_PIECES64(128), BYTE_PIECES64(192) }
+};
+static const float byte_vocab_scores[BYTE_VOCAB_SIZE] = { 0.0f };
+static uint32_t byte_vocab_offsets[BYTE_VOCAB_SIZE + 1];
+
+static void load_byte_vocab(Tokenizer* t) {
+    static const uint32_t special_offsets[TOKEN_BYTE_BASE] = { 0, 6, 12 };
+    for (int i = 0; i < TOKEN_BYTE_BASE; i++) {
+        byte_vocab_offsets[i] = special_offsets[i];
+    }
+    for (int i = 0; i <= 256; i++) {
+        byte_vocab_offsets[TOKEN_BYTE_BASE + i] = sizeof(byte_vocab.specials) + i * 2;
+    }
+    t->pool = byte_vocab.specials;
+    t->offsets = byte_vocab_offsets;
+    t->vocab_scores = byte_vocab_scores;
+    t->vocab_size = BYTE_VOCAB_SIZE;
+    t->max_token_length = 8;
+}
+
+// Point the tokenizer at a blob in place, -1 if it is not a valid blob
+// for this model
+static int load_blob(Tokenizer* t, const uint8_t* blob, size_t size, int vocab_size) {
+    const TokenizerBlobHeader* h = (const TokenizerBlobHeader*)blob;
+    if (size < sizeof(TokenizerBlobHeader) || h->magic != TOKENIZER_MAGIC ||
+        h->version != TOKENIZER_VERSION) {
+        printf("Invalid tokenizer blob\r\n");
+        return -1;
+    }
+    if (h->vocab_size != vocab_size) {
+        printf("Tokenizer has %d tokens, model expects %d\r\n", (int)h->vocab_size, vocab_size);
+        return -1;
+    }
+    size_t tables = sizeof(TokenizerBlobHeader) + sizeof(float) * h->vocab_size +
+                    sizeof(uint32_t) * (h->vocab_size + 1) +
+                    sizeof(int32_t) * (h->hash_buckets + h->hash_slots);
+    if (h->total_size > size || tables + h->pool_size != h->total_size ||
+        h->max_token_length <= 0 || h->max_token_length > TOKENIZER_MAX_PIECE ||
+        h->hash_buckets == 0 || h->hash_slots == 0) {
+        printf("Tokenizer blob is truncated or inconsistent\r\n");
+        return -1;
+    }
     
+    const uint8_t* p = blob + sizeof(TokenizerBlobHeader);
+    t->vocab_scores = (const float*)p;
+    p += sizeof(float) * h->vocab_size;
+    t->offsets = (const uint32_t*)p;
+    p += sizeof(uint32_t) * (h->vocab_size + 1);
+    t->hash.seeds = (const int32_t*)p;
+    p += sizeof(int32_t) * h->hash_buckets;
+    t->hash.ids = (const int32_t*)p;
+    p += sizeof(int32_t) * h->hash_slots;
+    t->pool = (const char*)p;
+    t->hash.n_buckets = h->hash_buckets;
+    t->hash.n_slots = h->hash_slots;
+    t->vocab_size = h->vocab_size;
+    t->max_token_length = h->max_token_length;
+    t->checksum = h->checksum;
+    if (t->offsets[h->vocab_size] != h->pool_size || t->pool[h->pool_size - 1] != '\0') {
+        printf("Tokenizer blob is truncated or inconsistent\r\n");
+        return -1;
+    }
+#ifdef MODEL_BLOB_VERIFY
+    if (crc32_update(0, blob + sizeof(TokenizerBlobHeader), h->total_size - sizeof(TokenizerBlobHeader)) !=
+        h->checksum) {
+        printf("Tokenizer blob checksum mismatch\r\n");
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+#if defined(__linux__)
+// Host builds: map a tokenizer blob written by extract_weights.py, used in
+// place like the linked-in one
+static int map_tokenizer(Tokenizer* t, const char* tokenizer_path) {
+    int fd = open(tokenizer_path, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open %s\r\n", tokenizer_path);
+        return -1;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED) {
+        printf("Cannot map %s\r\n", tokenizer_path);
+        close(fd);
+        return -1;
+    }
+    t->fd = fd;
+    t->file_data = data;
+    t->file_size = st.st_size;
+    return 0;
+}
+#endif
+
+uint32_t piece_hash(uint32_t seed, const char* str) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (const unsigned char* c = (const unsigned char*)str; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+// The vocabulary is read in place, so building the tokenizer only points
+// at the blob's tables: nothing is copied, sorted or allocated per token
+int build_tokenizer(Tokenizer* t, const char* tokenizer_path, int vocab_size) {
     printf("Building tokenizer with vocab size: %d\r\n", vocab_size);
-    
-    // For embedded demo, use simplified tokenizer
-    // In production, this would load from flash memory
-    
-    // Initialize byte pieces for single characters
-    for (int i = 0; i < 256; i++) {
-        t->byte_pieces[i * 2] = (unsigned char)i;
-        t->byte_pieces[i * 2 + 1] = '\0';
+    memset(&t->hash, 0, sizeof(t->hash));
+    t->checksum = 0;
+    t->fd = -1;
+    t->file_data = NULL;
+    t->file_size = 0;
+
+    // Byte pieces for single characters come from a const table
+    t->byte_pieces = byte_vocab.bytes;
+
+    const uint8_t* blob = tokenizer_blob;
+    size_t size = tokenizer_blob_size;
+    if (tokenizer_path) {
+#if defined(__linux__)
+        if (map_tokenizer(t, tokenizer_path) != 0) {
+            return -1;
+        }
+        blob = (const uint8_t*)t->file_data;
+        size = t->file_size;
+#else
+        printf("No file system: ignoring %s, using the linked-in tokenizer\r\n", tokenizer_path);
+#endif
     }
-    
+    if (blob) {
+        if (load_blob(t, blob, size, vocab_size) != 0) {
+            free_tokenizer(t);
+            return -1;
+        }
+    } else {
+        printf("No tokenizer data, using a byte-level vocabulary\r\n");
+        load_byte_vocab(t);
+    }
+
+    // Single-character tokens of the ASCII bytes, so encode() looks up
+    // only non-ASCII code points
+    t->ascii_tokens[0] = -1;
+    for (int c = 1; c < 128; c++) {
+        char piece[2] = { (char)c, '\0' };
+        t->ascii_tokens[c] = str_lookup(piece, t);
+    }
+
     printf("Tokenizer initialized successfully\r\n");
     return 0;
 }
 
 void free_tokenizer(Tokenizer* t) {
-    // Cleanup tokenizer resources
+    // Vocabulary is used in place, only a mapped file needs releasing
+#if defined(__linux__)
+    if (t->fd >= 0) {
+        munmap(t->file_data, t->file_size);
+        close(t->fd);
+        t->fd = -1;
+    }
+#endif
     printf("Tokenizer cleanup\r\n");
 }
 
-char* decode(Tokenizer* t, int prev_token, int token) {
-    // Simple character-based decoding for demo
-    static char piece[3];
-    
-    if (token < 256) {
-        piece[0] = (char)token;
-        piece[1] = '\0';
-        return piece;
+const char* decode(Tokenizer* t, int prev_token, int token) {
+    if (token < 0 || token >= t->vocab_size) {
+        return "";
+    }
+    const char* piece = tokenizer_piece(t, token);
+
+    // SentencePiece strips the leading space after BOS
+    if (prev_token == TOKEN_BOS && piece[0] == ' ') {
+        piece++;
+    }
+
+    // Raw byte tokens look like <0x01>
+    unsigned char byte_val;
+    if (sscanf(piece, "<0x%02hhX>", &byte_val) == 1) {
+        piece = (const char*)t->byte_pieces + byte_val * 2;
     }
-    
-    // For larger tokens, return placeholder
-    piece[0] = 'X';
-    piece[1] = '\0';
     return piece;
 }
 
-void safe_printf(char* piece) {
+void safe_printf(const char* piece) {
     // Print token piece safely
     if (piece) {
-        // Filter out control characters
-        for (int i = 0; piece[i] != '\0'; i++) {
-            if (piece[i] >= 32 && piece[i] <= 126) {
-                printf("%c", piece[i]);
+        // Filter out control characters, UTF-8 bytes pass through
+        for (const unsigned char* c = (const unsigned char*)piece; *c != '\0'; c++) {
+            if ((*c >= 32 && *c != 127) || *c == '\n') {
+                printf("%c", *c);
             }
         }
     }
 }
 
-int str_lookup(char* str, Tokenizer* t) {
-    // Simple string to token lookup
-    if (str && strlen(str) == 1) {
-        return (int)str[0];
+void detokenizer_init(Detokenizer* d) {
+    d->prev_token = TOKEN_BOS;
+    d->n_pending = 0;
+    d->n_needed = 0;
+}
+
+// Bounded writer for the detokenizer output, drops what does not fit
+typedef struct {
+    char* out;
+    size_t size;
+    size_t len;
+} TextWriter;
+
+static void write_bytes(TextWriter* w, const unsigned char* bytes, int n) {
+    for (int i = 0; i < n && w->len + 1 < w->size; i++) {
+        w->out[w->len++] = (char)bytes[i];
     }
-    return 0; // Unknown token
 }
 
-void encode(Tokenizer* t, char* text, int bos, int eos, int* tokens, int* n_tokens) {
-    // Simple character-based encoding
-    *n_tokens = 0;
+static void write_replacement(TextWriter* w) {
+    static const unsigned char replacement[3] = { 0xEF, 0xBF, 0xBD }; // U+FFFD
+    write_bytes(w, replacement, 3);
+}
+
+// Length of the code point a lead byte starts, 0 if it cannot start one
+static int utf8_length(unsigned char lead) {
+    if (lead < 0x80) {
+        return 1;
+    }
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        return 2;
+    }
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        return 3;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        return 4;
+    }
+    return 0;
+}
+
+static void detokenize_byte(Detokenizer* d, TextWriter* w, unsigned char byte) {
+    if (d->n_pending > 0) {
+        if ((byte & 0xC0) == 0x80) {
+            d->pending[d->n_pending++] = byte;
+            if (d->n_pending == d->n_needed) {
+                write_bytes(w, d->pending, d->n_pending);
+                d->n_pending = 0;
+            }
+            return;
+        }
+        // Code point cut short, byte starts a new one
+        write_replacement(w);
+        d->n_pending = 0;
+    }
+    int n = utf8_length(byte);
+    if (n == 1) {
+        write_bytes(w, &byte, 1);
+    } else if (n == 0) {
+        write_replacement(w);
+    } else {
+        d->pending[0] = byte;
+        d->n_pending = 1;
+        d->n_needed = n;
+    }
+}
+
+int detokenizer_push(Detokenizer* d, Tokenizer* t, int token, char* out, size_t out_size) {
+    TextWriter w = { out, out_size, 0 };
+    int prev_token = d->prev_token;
+    d->prev_token = token;
     
+    // BOS and EOS are control tokens, not text
+    if (token != TOKEN_BOS && token != TOKEN_EOS && token >= 0 && token < t->vocab_size) {
+        const char* piece = tokenizer_piece(t, token);
+        unsigned char byte_val;
+        if (piece[0] == '<' && sscanf(piece, "<0x%02hhX>", &byte_val) == 1) {
+            // Byte-fallback token, possibly part of a multi-byte code point
+            detokenize_byte(d, &w, byte_val);
+        } else {
+            // SentencePiece strips the leading space after BOS
+            if (prev_token == TOKEN_BOS && piece[0] == ' ') {
+                piece++;
+            }
+            for (const unsigned char* c = (const unsigned char*)piece; *c != '\0'; c++) {
+                detokenize_byte(d, &w, *c);
+            }
+        }
+    }
+    if (w.size > 0) {
+        out[w.len] = '\0';
+    }
+    return (int)w.len;
+}
+
+int detokenizer_flush(Detokenizer* d, char* out, size_t out_size) {
+    TextWriter w = { out, out_size, 0 };
+    if (d->n_pending > 0) {
+        write_replacement(&w);
+        d->n_pending = 0;
+    }
+    if (w.size > 0) {
+        out[w.len] = '\0';
+    }
+    return (int)w.len;
+}
+
+int str_lookup(const char* str, Tokenizer* t) {
+    // -1 if str is not in the vocab
+    if (t->hash.n_slots == 0) {
+        // Byte-level vocabulary: single bytes map directly, then the specials
+        if (str[0] != '\0' && str[1] == '\0') {
+            return TOKEN_BYTE_BASE + (unsigned char)str[0];
+        }
+        for (int i = 0; i < TOKEN_BYTE_BASE; i++) {
+            if (strcmp(str, tokenizer_piece(t, i)) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Perfect hash: one slot per piece, a single compare confirms it
+    const TokenizerHash* h = &t->hash;
+    int32_t seed = h->seeds[piece_hash(0, str) % h->n_buckets];
+    if (seed == 0) {
+        return -1;
+    }
+    uint32_t slot = seed < 0 ? (uint32_t)(-seed - 1) : piece_hash(seed, str) % h->n_slots;
+    int id = h->ids[slot];
+    return strcmp(str, tokenizer_piece(t, id)) == 0 ? id : -1;
+}
+
+// Candidate merge of two adjacent symbols, valid while both still hold
+// the tokens it was built from
+typedef struct {
+    float score;
+    int16_t left;
+    int16_t right;
+    int left_token;
+    int right_token;
+    int merged;
+} MergeCandidate;
+
+// Merge scratch: symbols form a linked list over tokens[], candidates a
+// max-heap by score, leftmost first on ties
+static int16_t sym_prev[TOKENIZER_MAX_TOKENS] NOINIT;
+static int16_t sym_next[TOKENIZER_MAX_TOKENS] NOINIT;
+static MergeCandidate heap[3 * TOKENIZER_MAX_TOKENS] NOINIT;
+static int heap_size;
+
+static int candidate_before(const MergeCandidate* a, const MergeCandidate* b) {
+    return a->score > b->score || (a->score == b->score && a->left < b->left);
+}
+
+static void heap_push(const MergeCandidate* c) {
+    int i = heap_size++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!candidate_before(c, &heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = *c;
+}
+
+static MergeCandidate heap_pop(void) {
+    MergeCandidate top = heap[0];
+    MergeCandidate last = heap[--heap_size];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap_size) {
+            break;
+        }
+        if (child + 1 < heap_size && candidate_before(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!candidate_before(&heap[child], &last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+// Queue the merge of symbols left and right if their concatenation is a token
+static void push_pair(Tokenizer* t, const int* tokens, int left, int right) {
+    if (left < 0 || right < 0) {
+        return;
+    }
+    uint32_t len_a = tokenizer_piece_len(t, tokens[left]);
+    uint32_t len_b = tokenizer_piece_len(t, tokens[right]);
+    if (len_a + len_b > t->max_token_length) {
+        return;
+    }
+    char buffer[TOKENIZER_MAX_PIECE + 1];
+    memcpy(buffer, tokenizer_piece(t, tokens[left]), len_a);
+    memcpy(buffer + len_a, tokenizer_piece(t, tokens[right]), len_b + 1);
+    int id = str_lookup(buffer, t);
+    if (id < 0) {
+        return;
+    }
+    MergeCandidate c = { t->vocab_scores[id], (int16_t)left, (int16_t)right, tokens[left], tokens[right], id };
+    heap_push(&c);
+}
+
+// Pre-tokenized text of the current encode() call
+static PreTokens pretokens NOINIT;
+
+// Merge the symbols sym[0..n) in place; returns how many are left
+static int merge_symbols(Tokenizer* t, int* sym, int n) {
+    heap_size = 0;
+    for (int i = 0; i < n; i++) {
+        sym_prev[i] = (int16_t)(i - 1);
+        sym_next[i] = (int16_t)(i + 1 < n ? i + 1 : -1);
+    }
+    for (int i = 0; i + 1 < n; i++) {
+        push_pair(t, sym, i, i + 1);
+    }
+    while (heap_size > 0) {
+        MergeCandidate c = heap_pop();
+        if (sym_next[c.left] != c.right || sym[c.left] != c.left_token || sym[c.right] != c.right_token) {
+            continue; // a neighbour was merged since this was queued
+        }
+
+        // Left symbol becomes the merged token, right one leaves the list
+        sym[c.left] = c.merged;
+        int next = sym_next[c.right];
+        sym_next[c.left] = (int16_t)next;
+        if (next >= 0) {
+            sym_prev[next] = c.left;
+        }
+        sym[c.right] = -1;
+        push_pair(t, sym, sym_prev[c.left], c.left);
+        push_pair(t, sym, c.left, next);
+    }
+
+    // Compact the surviving symbols
+    int out = 0;
+    for (int i = 0; i < n; i++) {
+        if (sym[i] >= 0) {
+            sym[out++] = sym[i];
+        }
+    }
+    return out;
+}
+
+void encode(Tokenizer* t, const char* text, int bos, int eos, int* tokens, int* n_tokens) {
+    // BPE as in SentencePiece: start from code points (or raw bytes when a
+    // code point is not in the vocab), then repeatedly merge the adjacent
+    // pair whose merged token scores highest. Candidates live in a heap
+    // and stale ones are skipped on pop, so this is O(n log n) instead of
+    // rescanning every pair after each merge. No merge crosses a
+    // pre-token piece (pretokenize.h), so each piece is merged on its own.
+    *n_tokens = 0;
     if (bos) {
-        tokens[(*n_tokens)++] = 1; // BOS token
+        tokens[(*n_tokens)++] = TOKEN_BOS;
     }
-    
-    // Encode each character
-    for (int i = 0; text[i] != '\0' && *n_tokens < 512; i++) {
-        tokens[(*n_tokens)++] = (int)text[i];
+    int start = *n_tokens;
+
+    // Leading space, as SentencePiece adds a dummy prefix
+    if (text[0] != '\0') {
+        int dummy_prefix = str_lookup(" ", t);
+        if (dummy_prefix >= 0) {
+            tokens[(*n_tokens)++] = dummy_prefix;
+        }
     }
-    
+
+    pretokenize(text, &pretokens);
+    if (pretokens.truncated) {
+        printf("Text truncated to %d bytes\r\n", PRETOKENIZE_MAX_BYTES);
+    }
+    int truncated = 0;
+    for (int p = 0; p < pretokens.n_pieces && !truncated; p++) {
+        // The dummy prefix belongs to the first piece
+        int first = p == 0 ? start : *n_tokens;
+        const char* c = text + pretokens.pieces[p].start;
+        const char* end = c + pretokens.pieces[p].len;
+
+        // One symbol per UTF-8 code point, ASCII ones from a table
+        while (c < end) {
+            if (*n_tokens - start >= TOKENIZER_MAX_TOKENS - 4) {
+                printf("Text truncated to %d tokens\r\n", TOKENIZER_MAX_TOKENS);
+                truncated = 1;
+                break;
+            }
+            unsigned char byte = (unsigned char)*c;
+            if (byte < 0x80) {
+                int id = t->ascii_tokens[byte];
+                tokens[(*n_tokens)++] = id >= 0 ? id : byte + TOKEN_BYTE_BASE;
+                c++;
+                continue;
+            }
+            char buffer[8];
+            size_t len = 1;
+            buffer[0] = *c;
+            while (c + len < end && ((unsigned char)c[len] & 0xC0) == 0x80 && len < 4) {
+                buffer[len] = c[len];
+                len++;
+            }
+            buffer[len] = '\0';
+            int id = str_lookup(buffer, t);
+            if (id >= 0) {
+                tokens[(*n_tokens)++] = id;
+            } else {
+                for (size_t i = 0; i < len; i++) {
+                    tokens[(*n_tokens)++] = (unsigned char)buffer[i] + TOKEN_BYTE_BASE;
+                }
+            }
+            c += len;
+        }
+        *n_tokens = first + merge_symbols(t, tokens + first, *n_tokens - first);
+    }
+
     if (eos) {
-        tokens[(*n_tokens)++] = 2; // EOS token
+        tokens[(*n_tokens)++] = TOKEN_EOS;
     }
-    
-    printf("Encoded %d tokens\r\n", *n_tokens);
 }
@@ -1,21 +1,110 @@
 #ifndef TOKENIZER_H
 #define TOKENIZER_H
 
-// Simple tokenizer for demo purposes
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tinyllama2.h"
+
+// SentencePiece-style BPE tokenizer. The vocabulary is a packed tokenizer
+// blob written by scripts/extract_weights.py, used in place: linked in as
+// tokenizer_data.c or, on the host, mapped from a file. Without one, a
+// byte-level vocabulary (<unk>, <s>, </s>, 256 bytes) is used.
+
+#define TOKENIZER_MAX_PIECE 64     // longest vocabulary piece, in bytes
+#define TOKENIZER_MAX_TOKENS 256   // longest text encode() tokenizes, in tokens
+
+#define TOKEN_UNK 0
+#define TOKEN_BOS 1
+#define TOKEN_EOS 2
+#define TOKEN_BYTE_BASE 3          // <0x00> .. <0xFF> byte fallback tokens
+
+// Tokenizer blob layout, must match scripts/extract_weights.py
+#define TOKENIZER_MAGIC 0x4B544C54 // "TLTK"
+#define TOKENIZER_VERSION 2
+
 typedef struct {
-    char** vocab;
-    float* vocab_scores;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    int32_t vocab_size;
+    int32_t max_token_length;
+    uint32_t pool_size;
+    uint32_t hash_buckets;
+    uint32_t hash_slots;
+    uint32_t checksum;            // CRC-32 of everything after the header
+} TokenizerBlobHeader;
+// followed by float scores[vocab_size], uint32 offsets[vocab_size + 1],
+// int32 hash seeds[hash_buckets], int32 hash ids[hash_slots] and the string
+// pool: NUL-terminated pieces in token order, piece i at pool + offsets[i]
+
+// Minimal perfect hash over the vocabulary pieces. A piece hashes (seed 0)
+// to a bucket; the bucket's entry is 0 if empty, -(slot + 1) for a single
+// piece, or the seed that hashes its pieces to distinct slots. ids maps
+// slots to tokens.
+typedef struct TokenizerHash {
+    const int32_t* seeds;         // (n_buckets,)
+    const int32_t* ids;           // (n_slots,)
+    uint32_t n_buckets;
+    uint32_t n_slots;             // distinct pieces, 0 for the byte-level vocabulary
+} TokenizerHash;
+
+typedef struct Tokenizer {
+    const char* pool;             // pieces, read in place from the blob
+    const uint32_t* offsets;      // (vocab_size + 1,)
+    const float* vocab_scores;    // (vocab_size,)
     int vocab_size;
     unsigned int max_token_length;
-    unsigned char byte_pieces[256*2]; // stores all single-byte strings
+    TokenizerHash hash;
+    uint32_t checksum;            // the blob's CRC-32, 0 for the byte-level vocabulary
+    const unsigned char* byte_pieces; // all single-byte strings, (256 * 2) in flash
+    int ascii_tokens[128];        // token of each single ASCII character, -1 if none
+    int fd;  // file descriptor of the mapped tokenizer, -1 for the linked-in blob
+    void* file_data;
+    size_t file_size;
 } Tokenizer;
 
+// Linked-in tokenizer blob, provided by tokenizer_data.c
+extern const uint8_t* const tokenizer_blob;   // NULL if none
+extern const uint32_t tokenizer_blob_size;
+
+static inline const char* tokenizer_piece(const Tokenizer* t, int id) {
+    return t->pool + t->offsets[id];
+}
+
+static inline uint32_t tokenizer_piece_len(const Tokenizer* t, int id) {
+    return t->offsets[id + 1] - t->offsets[id] - 1;
+}
+
+// Streaming detokenizer: turns generated tokens into text one token at a
+// time, holding back the bytes of a UTF-8 code point split across tokens
+// (byte-fallback <0xNN> tokens) so only complete code points are emitted
+typedef struct {
+    int prev_token;
+    unsigned char pending[4];     // start of an incomplete code point
+    int n_pending;
+    int n_needed;                 // length of that code point
+} Detokenizer;
+
+// Output of one detokenizer_push(), including the NUL: every byte of a
+// piece and the held-back bytes may each become U+FFFD (3 bytes)
+#define DETOKENIZER_MAX_OUTPUT (3 * (TOKENIZER_MAX_PIECE + 4) + 1)
+
+// Seeded FNV-1a over a piece, shared with the hash generator
+uint32_t piece_hash(uint32_t seed, const char* str);
+
 // Tokenizer functions
 int build_tokenizer(Tokenizer* t, const char* tokenizer_path, int vocab_size);
 void free_tokenizer(Tokenizer* t);
-char* decode(Tokenizer* t, int prev_token, int token);
-void safe_printf(char* piece);
-int str_lookup(char* str, Tokenizer* t);
-void encode(Tokenizer* t, char* text, int bos, int eos, int* tokens, int* n_tokens);
+const char* decode(Tokenizer* t, int prev_token, int token);
+void safe_printf(const char* piece);
+void detokenizer_init(Detokenizer* d);
+// Write the text token completes to out (NUL-terminated), returns its length
+int detokenizer_push(Detokenizer* d, Tokenizer* t, int token, char* out, size_t out_size);
+// Write what is still held back (an incomplete code point) as U+FFFD
+int detokenizer_flush(Detokenizer* d, char* out, size_t out_size);
+int str_lookup(const char* str, Tokenizer* t);
+// tokens must hold strlen(text) + 3 ids
+void encode(Tokenizer* t, const char* text, int bos, int eos, int* tokens, int* n_tokens);
 
 #endif // TOKENIZER_H
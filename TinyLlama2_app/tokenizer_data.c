@@ -0,0 +1,9 @@
+// Tokenizer vocabulary for TinyLlama2
+// Placeholder: no tokenizer blob is linked in, so build_tokenizer() falls back
+// to a byte-level vocabulary. Regenerate with scripts/extract_weights.py.
+
+#include "tokenizer.h"
+#include <stddef.h>
+
+const uint8_t* const tokenizer_blob = NULL;
+const uint32_t tokenizer_blob_size = 0;
@@ -1,15 +1,169 @@
 #include "tinyllama2.h"
 #include "transformer.h"
 #include "utils.h"
+#include "quant.h"
+#include "weight_stream.h"
+#include "memory_plan.h"
+#include "kv_cache.h"
+#include "lora.h"
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 // ARM CMSIS-DSP optimized operations
 #ifdef ARM_MATH_CM55
 #include "arm_math.h"
 #endif
 
-void rmsnorm(float* o, float* x, float* weight, int size) {
+// Helium with floating point (M55/M85 MVE-F) for the fixed-shape kernels
+#if defined(ARM_MATH_CM55) && defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 2)
+#include <arm_mve.h>
+#define TRANSFORMER_HELIUM_F32
+#endif
+
+// Full unrolling hint for loops whose trip count is a compile-time constant,
+// and forced inlining so a constant length reaches those loops
+#if defined(__GNUC__) || defined(__clang__)
+#define UNROLL_FULL _Pragma("GCC unroll 256")
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define UNROLL_FULL
+#define ALWAYS_INLINE inline
+#endif
+
+// Constant-length dot product for the fixed kernels below. n is a multiple
+// of 4 and a constant at every call site, so on the M55/M85 it is n / 4
+// full-width Helium multiply-accumulates with no tail predication; elsewhere
+// four independent scalar accumulators, fully unrolled.
+static ALWAYS_INLINE float dot_fixed(const float* a, const float* b, int n) {
+#ifdef TRANSFORMER_HELIUM_F32
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (int j = 0; j < n; j += 4) {
+        acc = vfmaq_f32(acc, vldrwq_f32(a + j), vldrwq_f32(b + j));
+    }
+    // MVE has no floating-point across-vector add
+    return (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1)) +
+           (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+#else
+    float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    UNROLL_FULL
+    for (int j = 0; j < n; j += 4) {
+        a0 += a[j] * b[j];
+        a1 += a[j + 1] * b[j + 1];
+        a2 += a[j + 2] * b[j + 2];
+        a3 += a[j + 3] * b[j + 3];
+    }
+    return (a0 + a1) + (a2 + a3);
+#endif
+}
+
+// Shape-specialized matmul: xout (D,) = w (D,N) @ x (N,)
+// N and D are compile-time constants, so each row is a dot_fixed() of
+// constant length with no tail handling. The runtime n and d only give
+// the kernels matmul()'s signature for the kernel table.
+#define DEFINE_MATMUL_FIXED(name, N, D)                                      \
+    _Static_assert((N) % 4 == 0, #name ": N must be a multiple of 4");       \
+    static ITCM_CODE void name(float* xout, float* x, float* w, int n, int d) {\
+        (void)n;                                                             \
+        (void)d;                                                             \
+        for (int i = 0; i < (D); i++) {                                      \
+            xout[i] = dot_fixed(x, w + i * (N), (N));                        \
+        }                                                                    \
+    }
+
+// Shape-specialized rmsnorm over a fixed vector length
+#define DEFINE_RMSNORM_FIXED(name, N)                                        \
+    _Static_assert((N) % 4 == 0, #name ": N must be a multiple of 4");       \
+    static ITCM_CODE void name(float* o, float* x, float* weight, int size) {\
+        (void)size;                                                          \
+        float ss = dot_fixed(x, x, (N));                                     \
+        ss = 1.0f / sqrtf_custom(ss / (N) + 1e-5f);                          \
+        UNROLL_FULL                                                          \
+        for (int j = 0; j < (N); j++) {                                      \
+            o[j] = weight[j] * (ss * x[j]);                                  \
+        }                                                                    \
+    }
+
+// Shape-specialized dot product for one attention head
+#define DEFINE_DOT_FIXED(name, N)                                            \
+    _Static_assert((N) % 4 == 0, #name ": N must be a multiple of 4");       \
+    static ITCM_CODE float name(float* a, float* b, int n) {                 \
+        (void)n;                                                             \
+        return dot_fixed(a, b, (N));                                         \
+    }
+
+static float dot_generic(float* a, float* b, int n) {
+    float acc = 0.0f;
+#ifdef ARM_MATH_CM55
+    arm_dot_prod_f32(a, b, n, &acc);
+#else
+    for (int i = 0; i < n; i++) {
+        acc += a[i] * b[i];
+    }
+#endif
+    return acc;
+}
+
+// Kernels for each projection, norm and head shape of the loaded model
+typedef struct {
+    void (*matmul_dim_dim)(float* xout, float* x, float* w, int n, int d);
+    void (*matmul_dim_kv)(float* xout, float* x, float* w, int n, int d);
+    void (*matmul_dim_hidden)(float* xout, float* x, float* w, int n, int d);
+    void (*matmul_hidden_dim)(float* xout, float* x, float* w, int n, int d);
+    void (*matmul_dim_vocab)(float* xout, float* x, float* w, int n, int d);
+    void (*rmsnorm_dim)(float* o, float* x, float* weight, int size);
+    float (*dot_head)(float* a, float* b, int n);
+} ShapeKernels;
+
+static const ShapeKernels generic_kernels = {
+    matmul, matmul, matmul, matmul, matmul, rmsnorm, dot_generic
+};
+
+// Shape dispatch: the demo model shapes from tinyllama2.h get their own
+// kernel instantiations, selected once at load when the blob has exactly
+// that shape; a model blob with any other shape uses the runtime-sized
+// kernels-> Define TINYLLAMA2_GENERIC_KERNELS to always use the generic
+// path (e.g. to compare results or save code size).
+#ifndef TINYLLAMA2_GENERIC_KERNELS
+DEFINE_MATMUL_FIXED(matmul_dim_dim, DIM, DIM)
+DEFINE_MATMUL_FIXED(matmul_dim_kv, DIM, KV_DIM)
+DEFINE_MATMUL_FIXED(matmul_dim_hidden, DIM, HIDDEN_DIM)
+DEFINE_MATMUL_FIXED(matmul_hidden_dim, HIDDEN_DIM, DIM)
+DEFINE_MATMUL_FIXED(matmul_dim_vocab, DIM, VOCAB_SIZE)
+DEFINE_RMSNORM_FIXED(rmsnorm_dim, DIM)
+DEFINE_DOT_FIXED(dot_head, HEAD_SIZE)
+
+static const ShapeKernels native_kernels = {
+    matmul_dim_dim, matmul_dim_kv, matmul_dim_hidden, matmul_hidden_dim, matmul_dim_vocab,
+    rmsnorm_dim, dot_head
+};
+#endif
+
+static const ShapeKernels* kernels = &generic_kernels;
+
+int transformer_select_kernels(const Config* p) {
+#ifndef TINYLLAMA2_GENERIC_KERNELS
+    if (p->dim == DIM && p->hidden_dim == HIDDEN_DIM && p->n_heads == N_HEADS &&
+        p->n_kv_heads == N_KV_HEADS && p->vocab_size == VOCAB_SIZE) {
+        kernels = &native_kernels;
+        return 1;
+    }
+#else
+    (void)p;
+#endif
+    kernels = &generic_kernels;
+    return 0;
+}
+
+#define MATMUL_DIM_DIM(p, o, x, w)     kernels->matmul_dim_dim(o, x, w, (p)->dim, (p)->dim)
+#define MATMUL_DIM_KV(p, o, x, w)      kernels->matmul_dim_kv(o, x, w, (p)->dim, CONFIG_KV_DIM(p))
+#define MATMUL_DIM_HIDDEN(p, o, x, w)  kernels->matmul_dim_hidden(o, x, w, (p)->dim, (p)->hidden_dim)
+#define MATMUL_HIDDEN_DIM(p, o, x, w)  kernels->matmul_hidden_dim(o, x, w, (p)->hidden_dim, (p)->dim)
+#define MATMUL_DIM_VOCAB(p, o, x, w)   kernels->matmul_dim_vocab(o, x, w, (p)->dim, (p)->vocab_size)
+#define RMSNORM_DIM(p, o, x, w)        kernels->rmsnorm_dim(o, x, w, (p)->dim)
+#define DOT_HEAD(p, a, b)              kernels->dot_head(a, b, (p)->dim / (p)->n_heads)
+
+ITCM_CODE void rmsnorm(float* o, float* x, float* weight, int size) {
     // Calculate sum of squares
     float ss = 0.0f;
     
@@ -31,7 +185,7 @@ void rmsnorm(float* o, float* x, float* weight, int size) {
     }
 }
 
-void matmul(float* xout, float* x, float* w, int n, int d) {
+ITCM_CODE void matmul(float* xout, float* x, float* w, int n, int d) {
     // Matrix multiplication: xout = x * w^T
     // x is (1, n), w is (d, n), xout is (1, d)
     
@@ -57,52 +211,201 @@ void matmul(float* xout, float* x, float* w, int n, int d) {
 #endif
 }
 
-void attention(RunState* s, TransformerWeights* w, Config* p, int layer, int pos) {
+// Liveness plan check: poison buffers that just died, verify the survivors
+#ifdef RUN_STATE_PLAN_CHECK
+#define PLAN_STEP(s, step) memory_plan_step((s)->plan, step)
+#else
+#define PLAN_STEP(s, step) ((void)0)
+#endif
+
+// Factored projection W ~= U (d, r) @ V (r, n): two chained small matmuls
+static ITCM_CODE void matmul_lowrank(float* xout, float* x, float* u, float* v, float* tmp, int n, int d, int r) {
+    matmul(tmp, x, v, n, r);
+    matmul(xout, tmp, u, r, d);
+}
+
+// One streamed tensor part, row tile by row tile as each lands in ISRAM:
+// fp32 rows when q is NULL, else rows of the quantized tensor q
+static ITCM_CODE void matmul_tiles(WeightStream* ws, const QuantizedTensor* q, int format, int tensor, int part,
+                                   int layer, float* xout, float* x, const QuantizedActivation* xq, int n, int d) {
+    int rows;
+    for (int row0 = 0; row0 < d; row0 += rows) {
+        const uint8_t* tile = weight_stream_rows(ws, layer, tensor, part, row0, &rows);
+        if (!q) {
+            matmul(xout + row0, x, (float*)tile, n, rows);
+        } else {
+            QuantizedTensor t;
+            quantized_rows(&t, q, format, layer, row0, d, tile);
+            matmul_quantized(xout + row0, x, xq, &t, format, 0, n, rows);
+        }
+    }
+}
+
+// Projection xout (d,) = tensor[layer] (d, n) @ x through the weight
+// stream: dense, quantized (x prepared in s->xq) or low-rank V then U
+static ITCM_CODE void matmul_streamed(RunState* s, TransformerWeights* w, Config* p, int tensor,
+                                      const QuantizedTensor* q, int layer, float* xout, float* x, int n, int d) {
+    WeightStream* ws = w->stream;
+    if (weight_stream_has(ws, tensor, TENSOR_PART_LOWRANK_U)) {
+        matmul_tiles(ws, NULL, 0, tensor, TENSOR_PART_LOWRANK_V, layer, s->lr, x, NULL, n, p->lowrank_rank);
+        matmul_tiles(ws, NULL, 0, tensor, TENSOR_PART_LOWRANK_U, layer, xout, s->lr, NULL, p->lowrank_rank, d);
+    } else {
+        matmul_tiles(ws, p->weight_format == WEIGHT_FORMAT_F32 ? NULL : q, p->weight_format, tensor,
+                     TENSOR_PART_DATA, layer, xout, x, &s->xq, n, d);
+    }
+}
+
+// LoRA delta on top of a base projection: xout (d,) += scale * B (d, r) @ A (r, n) @ x
+static ITCM_CODE void lora_apply(float* xout, float* x, const LoraAdapter* lora, int target, int layer,
+                                 float* tmp, int n, int d) {
+    float* a = lora->a[target];
+    if (!a) {
+        return;
+    }
+    int r = lora->rank;
+    float* b = lora->b[target] + layer * d * r;
+    matmul(tmp, x, a + layer * r * n, n, r);
+    for (int i = 0; i < r; i++) {
+        tmp[i] *= lora->scale;
+    }
+    for (int i = 0; i < d; i++) {
+        xout[i] += dot_generic(b + i * r, tmp, r);
+    }
+}
+
+// Rotary position embedding: cos and sin of pos * theta^(-2i / head_size)
+// for each frequency i, computed once per token and shared by every layer
+static void rope_angles(float* rope, int pos, int head_size, float theta) {
+    int half = head_size / 2;
+    float log_theta = logf_custom(theta);
+    for (int i = 0; i < half; i++) {
+        float freq = expf_custom(-2.0f * (float)i / (float)head_size * log_theta);
+        sincosf_custom((float)pos * freq, &rope[half + i], &rope[i]);
+    }
+}
+
+// Rotate each head's pairs (i, i + head_size / 2) in place, the Hugging Face
+// Llama layout extract_weights.py keeps the q/k projections in
+ITCM_CODE static void rope_rotate(float* v, int n_heads, int head_size, const float* rope) {
+    int half = head_size / 2;
+    const float* cos_t = rope;
+    const float* sin_t = rope + half;
+    for (int h = 0; h < n_heads; h++) {
+        float* x = v + h * head_size;
+        for (int i = 0; i < half; i++) {
+            float x0 = x[i];
+            float x1 = x[i + half];
+            x[i] = x0 * cos_t[i] - x1 * sin_t[i];
+            x[i + half] = x1 * cos_t[i] + x0 * sin_t[i];
+        }
+    }
+}
+
+// Adapter of the current session, if any, next to the base projection
+#define LORA(s, target, layer, o, x, n, d) \
+    do { if ((s)->lora) lora_apply(o, x, (s)->lora, target, layer, (s)->lora_tmp, n, d); } while (0)
+
+ITCM_CODE void attention(RunState* s, TransformerWeights* w, Config* p, int layer, int pos) {
     int head_size = p->dim / p->n_heads;
+    int kv_dim = CONFIG_KV_DIM(p);
+    int kv_mul = p->n_heads / p->n_kv_heads; // query heads per KV head
+    
+    // Key and value of this position go straight into the paged cache
+    s->k = kv_key(s->kv, layer, pos);
+    s->v = kv_value(s->kv, layer, pos);
     
     // Get the query, key, value vectors for this position
-    matmul(s->q, s->x, w->wq + layer * p->dim * p->dim, p->dim, p->dim);
-    matmul(s->k, s->x, w->wk + layer * p->dim * p->dim, p->dim, p->dim);
-    matmul(s->v, s->x, w->wv + layer * p->dim * p->dim, p->dim, p->dim);
+    PLAN_STEP(s, STEP_QKV);
+    if (w->stream) {
+        prepare_activation(&s->xq, s->xb, p->dim, p->weight_format);
+        matmul_streamed(s, w, p, TENSOR_WQ, &w->wq_q, layer, s->q, s->xb, p->dim, p->dim);
+        matmul_streamed(s, w, p, TENSOR_WK, &w->wk_q, layer, s->k, s->xb, p->dim, kv_dim);
+        matmul_streamed(s, w, p, TENSOR_WV, &w->wv_q, layer, s->v, s->xb, p->dim, kv_dim);
+    } else if (p->weight_format == WEIGHT_FORMAT_F32) {
+        MATMUL_DIM_DIM(p, s->q, s->xb, w->wq + layer * p->dim * p->dim);
+        MATMUL_DIM_KV(p, s->k, s->xb, w->wk + layer * p->dim * kv_dim);
+        MATMUL_DIM_KV(p, s->v, s->xb, w->wv + layer * p->dim * kv_dim);
+    } else {
+        // One activation quantization shared by all three projections
+        prepare_activation(&s->xq, s->xb, p->dim, p->weight_format);
+        matmul_quantized(s->q, s->xb, &s->xq, &w->wq_q, p->weight_format, layer, p->dim, p->dim);
+        matmul_quantized(s->k, s->xb, &s->xq, &w->wk_q, p->weight_format, layer, p->dim, kv_dim);
+        matmul_quantized(s->v, s->xb, &s->xq, &w->wv_q, p->weight_format, layer, p->dim, kv_dim);
+    }
+    LORA(s, LORA_WQ, layer, s->q, s->xb, p->dim, p->dim);
+    LORA(s, LORA_WK, layer, s->k, s->xb, p->dim, kv_dim);
+    LORA(s, LORA_WV, layer, s->v, s->xb, p->dim, kv_dim);
+    
+    // Position enters through the rotation of q and k; the cache keeps
+    // rotated keys
+    rope_rotate(s->q, p->n_heads, head_size, s->rope);
+    rope_rotate(s->k, p->n_kv_heads, head_size, s->rope);
     
-    // Attention computation (simplified for demo)
+    // Attention scores of every query head over positions 0..pos, read
+    // block by block through the sequence's block table
+    PLAN_STEP(s, STEP_SCORES);
+    float inv_scale = 1.0f / sqrtf_custom((float)head_size);
     for (int h = 0; h < p->n_heads; h++) {
         float* q_head = s->q + h * head_size;
-        float* k_head = s->k + h * head_size;
-        float* v_head = s->v + h * head_size;
-        
-        // Compute attention scores
-        float score = 0.0f;
-#ifdef ARM_MATH_CM55
-        arm_dot_prod_f32(q_head, k_head, head_size, &score);
-#else
-        for (int i = 0; i < head_size; i++) {
-            score += q_head[i] * k_head[i];
+        float* att = s->att + h * p->seq_len;
+        int kv_offset = (h / kv_mul) * head_size;
+        for (int t = 0; t <= pos; t++) {
+            att[t] = DOT_HEAD(p, q_head, kv_key(s->kv, layer, t) + kv_offset) * inv_scale;
         }
-#endif
-        score /= sqrtf_custom((float)head_size);
-        
-        // Apply softmax (simplified)
-        s->att[h] = expf_custom(score);
+        softmax(att, pos + 1);
     }
     
-    // Normalize attention weights
-    float sum = 0.0f;
-    for (int h = 0; h < p->n_heads; h++) {
-        sum += s->att[h];
-    }
+    // Weighted sum of the cached values, one output slice per query head
+    PLAN_STEP(s, STEP_MIX);
     for (int h = 0; h < p->n_heads; h++) {
-        s->att[h] /= sum;
+        float* att = s->att + h * p->seq_len;
+        float* out = s->xb2 + h * head_size;
+        int kv_offset = (h / kv_mul) * head_size;
+        memset(out, 0, head_size * sizeof(float));
+        for (int t = 0; t <= pos; t++) {
+            float* v_head = kv_value(s->kv, layer, t) + kv_offset;
+            float a = att[t];
+            for (int i = 0; i < head_size; i++) {
+                out[i] += a * v_head[i];
+            }
+        }
     }
     
     // Output projection
-    matmul(s->xb, s->v, w->wo + layer * p->dim * p->dim, p->dim, p->dim);
+    PLAN_STEP(s, STEP_WO);
+    if (w->stream) {
+        prepare_activation(&s->xq, s->xb2, p->dim, p->weight_format);
+        matmul_streamed(s, w, p, TENSOR_WO, &w->wo_q, layer, s->xb, s->xb2, p->dim, p->dim);
+    } else if (w->wo_u) {
+        int r = p->lowrank_rank;
+        matmul_lowrank(s->xb, s->xb2, w->wo_u + layer * p->dim * r, w->wo_v + layer * r * p->dim,
+                       s->lr, p->dim, p->dim, r);
+    } else if (p->weight_format == WEIGHT_FORMAT_F32) {
+        MATMUL_DIM_DIM(p, s->xb, s->xb2, w->wo + layer * p->dim * p->dim);
+    } else {
+        prepare_activation(&s->xq, s->xb2, p->dim, p->weight_format);
+        matmul_quantized(s->xb, s->xb2, &s->xq, &w->wo_q, p->weight_format, layer, p->dim, p->dim);
+    }
+    LORA(s, LORA_WO, layer, s->xb, s->xb2, p->dim, p->dim);
 }
 
-void ffn(RunState* s, TransformerWeights* w, Config* p, int layer) {
+ITCM_CODE void ffn(RunState* s, TransformerWeights* w, Config* p, int layer) {
     // Feed-forward network
-    matmul(s->hb, s->x, w->w1 + layer * p->dim * p->hidden_dim, p->dim, p->hidden_dim);
-    matmul(s->hb2, s->x, w->w3 + layer * p->dim * p->hidden_dim, p->dim, p->hidden_dim);
+    PLAN_STEP(s, STEP_FFN_UP);
+    if (w->stream) {
+        prepare_activation(&s->xq, s->xb, p->dim, p->weight_format);
+        matmul_streamed(s, w, p, TENSOR_W1, &w->w1_q, layer, s->hb, s->xb, p->dim, p->hidden_dim);
+        matmul_streamed(s, w, p, TENSOR_W3, &w->w3_q, layer, s->hb2, s->xb, p->dim, p->hidden_dim);
+    } else if (p->weight_format == WEIGHT_FORMAT_F32) {
+        MATMUL_DIM_HIDDEN(p, s->hb, s->xb, w->w1 + layer * p->dim * p->hidden_dim);
+        MATMUL_DIM_HIDDEN(p, s->hb2, s->xb, w->w3 + layer * p->dim * p->hidden_dim);
+    } else {
+        prepare_activation(&s->xq, s->xb, p->dim, p->weight_format);
+        matmul_quantized(s->hb, s->xb, &s->xq, &w->w1_q, p->weight_format, layer, p->dim, p->hidden_dim);
+        matmul_quantized(s->hb2, s->xb, &s->xq, &w->w3_q, p->weight_format, layer, p->dim, p->hidden_dim);
+    }
+    LORA(s, LORA_W1, layer, s->hb, s->xb, p->dim, p->hidden_dim);
+    LORA(s, LORA_W3, layer, s->hb2, s->xb, p->dim, p->hidden_dim);
     
     // Apply SiLU activation: x * sigmoid(x)
     for (int i = 0; i < p->hidden_dim; i++) {
@@ -112,20 +415,47 @@ void ffn(RunState* s, TransformerWeights* w, Config* p, int layer) {
     }
     
     // Output projection
-    matmul(s->xb, s->hb, w->w2 + layer * p->hidden_dim * p->dim, p->hidden_dim, p->dim);
+    PLAN_STEP(s, STEP_W2);
+    if (w->stream) {
+        prepare_activation(&s->xq, s->hb, p->hidden_dim, p->weight_format);
+        matmul_streamed(s, w, p, TENSOR_W2, &w->w2_q, layer, s->xb, s->hb, p->hidden_dim, p->dim);
+    } else if (w->w2_u) {
+        int r = p->lowrank_rank;
+        matmul_lowrank(s->xb, s->hb, w->w2_u + layer * p->dim * r, w->w2_v + layer * r * p->hidden_dim,
+                       s->lr, p->hidden_dim, p->dim, r);
+    } else if (p->weight_format == WEIGHT_FORMAT_F32) {
+        MATMUL_HIDDEN_DIM(p, s->xb, s->hb, w->w2 + layer * p->hidden_dim * p->dim);
+    } else {
+        prepare_activation(&s->xq, s->hb, p->hidden_dim, p->weight_format);
+        matmul_quantized(s->xb, s->hb, &s->xq, &w->w2_q, p->weight_format, layer, p->hidden_dim, p->dim);
+    }
+    LORA(s, LORA_W2, layer, s->xb, s->hb, p->hidden_dim, p->dim);
 }
 
-void transformer_forward(int token, int pos, Config* p, RunState* s, TransformerWeights* w) {
+int transformer_forward(int token, int pos, Config* p, RunState* s, TransformerWeights* w) {
+    // Make room for this position in the paged KV cache
+    if (pos >= p->seq_len || kv_seq_reserve(s->kv, pos) != 0) {
+        printf("Position %d does not fit in the KV cache\r\n", pos);
+        return -1;
+    }
+    
     // Token embedding
-    float* content_row = w->token_embedding_table + token * p->dim;
-    for (int i = 0; i < p->dim; i++) {
-        s->x[i] = content_row[i];
+    PLAN_STEP(s, STEP_EMBED);
+    if (p->weight_format == WEIGHT_FORMAT_CB4 || p->weight_format == WEIGHT_FORMAT_CB8) {
+        dequantize_codebook_row(s->x, &w->token_embedding_q, p->weight_format, token, p->dim);
+    } else {
+        float* content_row = w->token_embedding_table + token * p->dim;
+        for (int i = 0; i < p->dim; i++) {
+            s->x[i] = content_row[i];
+        }
     }
+    rope_angles(s->rope, pos, p->dim / p->n_heads, p->rope_theta);
     
     // Forward through layers
     for (int l = 0; l < p->n_layers; l++) {
         // Attention block
-        rmsnorm(s->xb, s->x, w->rms_att_weight + l * p->dim, p->dim);
+        PLAN_STEP(s, STEP_ATTN_NORM);
+        RMSNORM_DIM(p, s->xb, s->x, w->rms_att_weight + l * p->dim);
         attention(s, w, p, l, pos);
         
         // Residual connection
@@ -134,7 +464,8 @@ void transformer_forward(int token, int pos, Config* p, RunState* s, Transformer
         }
         
         // FFN block
-        rmsnorm(s->xb, s->x, w->rms_ffn_weight + l * p->dim, p->dim);
+        PLAN_STEP(s, STEP_FFN_NORM);
+        RMSNORM_DIM(p, s->xb, s->x, w->rms_ffn_weight + l * p->dim);
         ffn(s, w, p, l);
         
         // Residual connection
@@ -144,13 +475,26 @@ void transformer_forward(int token, int pos, Config* p, RunState* s, Transformer
     }
     
     // Final norm
-    rmsnorm(s->x, s->x, w->rms_final_weight, p->dim);
+    PLAN_STEP(s, STEP_FINAL_NORM);
+    RMSNORM_DIM(p, s->x, s->x, w->rms_final_weight);
     
     // Classifier
-    matmul(s->logits, s->x, w->wcls, p->dim, p->vocab_size);
+    PLAN_STEP(s, STEP_CLASSIFIER);
+    if (w->wcls_u) {
+        matmul_lowrank(s->logits, s->x, w->wcls_u, w->wcls_v, s->lr, p->dim, p->vocab_size, p->lowrank_rank);
+    } else if (w->wcls) {
+        // fp32 weights, or a classifier shared with an fp32 embedding
+        MATMUL_DIM_VOCAB(p, s->logits, s->x, w->wcls);
+    } else {
+        prepare_activation(&s->xq, s->x, p->dim, p->weight_format);
+        matmul_quantized(s->logits, s->x, &s->xq, &w->wcls_q, p->weight_format, 0, p->dim, p->vocab_size);
+    }
+    return 0;
 }
 
 float* forward(Transformer* transformer, int token, int pos) {
-    transformer_forward(token, pos, &transformer->config, &transformer->state, &transformer->weights);
+    if (transformer_forward(token, pos, &transformer->config, &transformer->state, &transformer->weights) != 0) {
+        return NULL;
+    }
     return transformer->state.logits;
 }
@@ -8,9 +8,13 @@ void rmsnorm(float* o, float* x, float* weight, int size);
 void matmul(float* xout, float* x, float* w, int n, int d);
 void attention(RunState* s, TransformerWeights* w, Config* p, int layer, int pos);
 void ffn(RunState* s, TransformerWeights* w, Config* p, int layer);
-void transformer_forward(int token, int pos, Config* p, RunState* s, TransformerWeights* w);
+// Pick the fixed-shape kernels when the model has the compiled-in demo
+// shape, the runtime-sized ones otherwise; 1 if the fixed ones were picked
+int transformer_select_kernels(const Config* p);
+int transformer_forward(int token, int pos, Config* p, RunState* s, TransformerWeights* w);
 
 // Utility functions
+// Logits for token at pos, NULL if pos does not fit in the KV cache
 float* forward(Transformer* transformer, int token, int pos);
 
 #endif // TRANSFORMER_H
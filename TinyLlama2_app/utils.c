@@ -1,42 +1,124 @@
 #include "tinyllama2.h"
 #include "utils.h"
+#include "model_blob.h"
+#include "arena.h"
+#include "memory_plan.h"
+#include "kv_cache.h"
+#include "lora.h"
+#include "quant.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-void malloc_run_state(RunState* s, Config* p) {
-    // Allocate memory for runtime state
-    // In embedded systems, this might use static allocation instead
+int malloc_run_state(RunState* s, Config* p) {
+    // Carve the runtime state out of two static arenas, sized from the
+    // model config read at init rather than from the compile-time defines
     
     printf("Allocating runtime state...\r\n");
     
-    // For demo purposes, use static arrays to avoid malloc issues
-    static float x_buffer[DIM];
-    static float xb_buffer[DIM];
-    static float xb2_buffer[DIM];
-    static float hb_buffer[HIDDEN_DIM];
-    static float hb2_buffer[HIDDEN_DIM];
-    static float q_buffer[DIM];
-    static float k_buffer[DIM];
-    static float v_buffer[DIM];
-    static float att_buffer[N_HEADS * MAX_SEQ_LEN];
-    static float logits_buffer[VOCAB_SIZE];
-    static float key_cache_buffer[N_LAYERS * MAX_SEQ_LEN * DIM];
-    static float value_cache_buffer[N_LAYERS * MAX_SEQ_LEN * DIM];
-    
-    s->x = x_buffer;
-    s->xb = xb_buffer;
-    s->xb2 = xb2_buffer;
-    s->hb = hb_buffer;
-    s->hb2 = hb2_buffer;
-    s->q = q_buffer;
-    s->k = k_buffer;
-    s->v = v_buffer;
-    s->att = att_buffer;
-    s->logits = logits_buffer;
-    s->key_cache = key_cache_buffer;
-    s->value_cache = value_cache_buffer;
+    // Activations in one aligned arena per DTCM bank, KV cache blocks in
+    // SRAM. Neither is zeroed at boot: everything is written before it is read.
+    static uint8_t bank0_store[RUN_STATE_BANK_BYTES] RUN_STATE_BANK_PLACEMENT(0) __attribute__((aligned(ARENA_ALIGN)));
+    static uint8_t bank1_store[RUN_STATE_BANK_BYTES] RUN_STATE_BANK_PLACEMENT(1) __attribute__((aligned(ARENA_ALIGN)));
+    static uint8_t bank2_store[RUN_STATE_BANK_BYTES] RUN_STATE_BANK_PLACEMENT(2) __attribute__((aligned(ARENA_ALIGN)));
+    static uint8_t bank3_store[RUN_STATE_BANK_BYTES] RUN_STATE_BANK_PLACEMENT(3) __attribute__((aligned(ARENA_ALIGN)));
+    static uint8_t kv_store[KV_CACHE_POOL_BYTES] NOINIT __attribute__((aligned(ARENA_ALIGN)));
+    static uint8_t* const bank_stores[DTCM_BANKS] = { bank0_store, bank1_store, bank2_store, bank3_store };
+    static const char* const bank_names[DTCM_BANKS] = { "dtcm0", "dtcm1", "dtcm2", "dtcm3" };
+    static Arena bank_arenas[DTCM_BANKS];
+    static KVPool kv_pool;
+    static KVSequence kv_seq;
+    static KVSequence prompt_seq;
+    for (int b = 0; b < DTCM_BANKS; b++) {
+        arena_init(&bank_arenas[b], bank_names[b], bank_stores[b], RUN_STATE_BANK_BYTES);
+    }
+    
+    int kv_dim = CONFIG_KV_DIM(p);
+    int max_hidden = p->hidden_dim > p->dim ? p->hidden_dim : p->dim;
+    
+    // The block pool decides the longest context one sequence can hold
+    int n_blocks = kv_pool_init(&kv_pool, kv_store, sizeof(kv_store), p->n_layers, kv_dim);
+    int max_seq_len = n_blocks * KV_BLOCK_SIZE;
+    printf("KV cache: %d blocks of %d positions, %u bytes each\r\n", n_blocks, KV_BLOCK_SIZE,
+           (unsigned)(kv_pool.block_floats * sizeof(float)));
+    if (p->seq_len > max_seq_len) {
+        printf("KV cache pool holds %d positions, clamping seq_len from %d\r\n", max_seq_len, p->seq_len);
+        p->seq_len = max_seq_len;
+    }
+    kv_seq_init(&kv_seq, &kv_pool);
+    s->kv_pool = &kv_pool;
+    s->kv = &kv_seq;
+    kv_seq_init(&prompt_seq, &kv_pool);
+    s->prompt_kv = &prompt_seq;
+    s->prompt_len = 0;
+    
+    // Activation lifetimes over one forward pass (see memory_plan.h);
+    // buffers never live at the same time share memory. Each kernel reads
+    // and writes different banks: rmsnorm x -> xb, QKV xb/xq -> q,
+    // scores q -> att, mix att -> xb2, wo xb2/xq -> xb, FFN xb/xq -> hb/hb2,
+    // w2 hb/xq -> xb, classifier xq -> logits, with the low-rank and LoRA
+    // intermediates away from both sides. Only the final rmsnorm (x in
+    // place) and quantizing x for the classifier stay in one bank.
+    enum { BUF_X, BUF_XB, BUF_XB2, BUF_Q, BUF_ATT, BUF_HB, BUF_HB2,
+           BUF_LOGITS, BUF_XQ, BUF_LR, BUF_LORA, BUF_ROPE, BUF_COUNT };
+    static PlanBuffer buffers[BUF_COUNT];
+    static MemoryPlan plan;
+    buffers[BUF_X] = (PlanBuffer){ "x", p->dim * sizeof(float), STEP_EMBED, STEP_CLASSIFIER, 0, 0, 0 };
+    buffers[BUF_XB] = (PlanBuffer){ "xb", p->dim * sizeof(float), STEP_ATTN_NORM, STEP_W2, 0, 1, 0 };
+    buffers[BUF_XB2] = (PlanBuffer){ "xb2", p->dim * sizeof(float), STEP_MIX, STEP_WO, 0, 2, 0 };
+    buffers[BUF_Q] = (PlanBuffer){ "q", p->dim * sizeof(float), STEP_QKV, STEP_SCORES, 0, 2, 0 };
+    buffers[BUF_ATT] = (PlanBuffer){ "att", p->n_heads * p->seq_len * sizeof(float), STEP_SCORES, STEP_MIX, 1, 3, 0 };
+    buffers[BUF_HB] = (PlanBuffer){ "hb", p->hidden_dim * sizeof(float), STEP_FFN_UP, STEP_W2, 0, 2, 0 };
+    buffers[BUF_HB2] = (PlanBuffer){ "hb2", p->hidden_dim * sizeof(float), STEP_FFN_UP, STEP_FFN_UP, 0, 3, 0 };
+    buffers[BUF_LOGITS] = (PlanBuffer){ "logits", p->vocab_size * sizeof(float), STEP_CLASSIFIER, STEP_CLASSIFIER, 0, 1, 0 };
+    buffers[BUF_XQ] = (PlanBuffer){ "xq", max_hidden, STEP_QKV, STEP_CLASSIFIER, 1, 0, 0 };
+    buffers[BUF_LR] = (PlanBuffer){ "lowrank", p->lowrank_rank * sizeof(float), STEP_WO, STEP_CLASSIFIER, 0, 3, 0 };
+    buffers[BUF_LORA] = (PlanBuffer){ "lora", lora_max_rank() * sizeof(float), STEP_QKV, STEP_W2, 1, 0, 0 };
+    buffers[BUF_ROPE] = (PlanBuffer){ "rope", (p->dim / p->n_heads) * sizeof(float), STEP_EMBED, STEP_W2, 0, 0, 0 };
+    
+    size_t bank_bytes[PLAN_MAX_BANKS];
+    size_t plan_bytes = memory_plan_solve(buffers, BUF_COUNT, bank_bytes);
+    memory_plan_report(buffers, BUF_COUNT, plan_bytes);
+    int placed = plan_bytes > 0;
+    for (int b = 0; b < DTCM_BANKS; b++) {
+        plan.base[b] = arena_alloc(&bank_arenas[b], "activations", bank_bytes[b]);
+        placed &= plan.base[b] != NULL;
+    }
+    if (placed) {
+        uint8_t* at[BUF_COUNT];
+        for (int i = 0; i < BUF_COUNT; i++) {
+            at[i] = plan.base[buffers[i].bank] + buffers[i].offset;
+        }
+        s->x = (float*)at[BUF_X];
+        s->xb = (float*)at[BUF_XB];
+        s->xb2 = (float*)at[BUF_XB2];
+        s->q = (float*)at[BUF_Q];
+        s->att = (float*)at[BUF_ATT];
+        s->hb = (float*)at[BUF_HB];
+        s->hb2 = (float*)at[BUF_HB2];
+        s->logits = (float*)at[BUF_LOGITS];
+        s->xq.q = (int8_t*)at[BUF_XQ];
+        s->lr = p->lowrank_rank > 0 ? (float*)at[BUF_LR] : NULL;
+        s->lora_tmp = lora_max_rank() > 0 ? (float*)at[BUF_LORA] : NULL;
+        s->rope = (float*)at[BUF_ROPE];
+    }
+    s->xq.s = 0.0f;
+    s->lora = NULL;
+    plan.buffers = buffers;
+    plan.n_buffers = BUF_COUNT;
+    plan.step = STEP_CLASSIFIER;
+    s->plan = &plan;
+    
+    for (int b = 0; b < DTCM_BANKS; b++) {
+        arena_report(&bank_arenas[b]);
+    }
+    
+    if (!placed || n_blocks == 0) {
+        printf("Runtime state exceeds its memory budget\r\n");
+        return -1;
+    }
     
     printf("Runtime state allocated successfully\r\n");
+    return 0;
 }
 
 void free_run_state(RunState* s) {
@@ -44,26 +126,242 @@ void free_run_state(RunState* s) {
     printf("Runtime state cleanup\r\n");
 }
 
-void memory_map_weights(TransformerWeights *w, Config* p, float* ptr, int shared_weights) {
-    // Map model weights from memory
-    // In real implementation, this would map from flash memory
+int read_model_config(Config* p, const uint8_t* blob) {
+    // Model dimensions and formats come from the blob header, so one
+    // firmware build runs any model size that fits in memory
+    const ModelBlobHeader* h = (const ModelBlobHeader*)blob;
+    if (h->magic != MODEL_BLOB_MAGIC || h->version != MODEL_BLOB_VERSION) {
+        printf("Invalid model blob (magic 0x%08lX, version %lu)\r\n",
+               (unsigned long)h->magic, (unsigned long)h->version);
+        return -1;
+    }
+    if (h->total_size < sizeof(ModelBlobHeader) ||
+        h->dim <= 0 || h->hidden_dim <= 0 || h->n_layers <= 0 || h->n_heads <= 0 ||
+        h->n_kv_heads <= 0 || h->vocab_size <= 0 || h->seq_len <= 0 ||
+        h->lowrank_rank < 0 || h->lowrank_rank > h->dim ||
+        h->dim % h->n_heads != 0 || h->n_heads % h->n_kv_heads != 0 ||
+        (h->dim / h->n_heads) % 2 != 0 || !(h->rope_theta >= 0.0f) ||
+        h->weight_format < WEIGHT_FORMAT_F32 || h->weight_format > WEIGHT_FORMAT_Q8_HUFFMAN) {
+        printf("Model blob header has an unsupported configuration\r\n");
+        return -1;
+    }
+    
+#ifdef MODEL_BLOB_VERIFY
+    // Reads the whole blob, so opt-in: catches a corrupted flash image or a
+    // model.bin cut short or edited after extract_weights.py wrote it
+    if (h->checksum != 0 &&
+        crc32_update(0, blob + sizeof(ModelBlobHeader), h->total_size - sizeof(ModelBlobHeader)) != h->checksum) {
+        printf("Model blob checksum mismatch\r\n");
+        return -1;
+    }
+#endif
+    
+    // Row lengths the kernels of each format rely on (projection inputs are
+    // dim or hidden_dim wide)
+    int format = h->weight_format;
+    if ((format == WEIGHT_FORMAT_TERNARY && (h->dim % 32 != 0 || h->hidden_dim % 32 != 0)) ||
+        (format == WEIGHT_FORMAT_CB4 && (h->dim % 2 != 0 || h->hidden_dim % 2 != 0)) ||
+        (format == WEIGHT_FORMAT_Q8_HUFFMAN && (h->dim > HUFFMAN_TILE_BYTES || h->hidden_dim > HUFFMAN_TILE_BYTES))) {
+        printf("Model blob dimensions %ld/%ld do not fit its weight format\r\n",
+               (long)h->dim, (long)h->hidden_dim);
+        return -1;
+    }
+    
+    p->dim = h->dim;
+    p->hidden_dim = h->hidden_dim;
+    p->n_layers = h->n_layers;
+    p->n_heads = h->n_heads;
+    p->n_kv_heads = h->n_kv_heads;
+    p->vocab_size = h->vocab_size;
+    p->seq_len = h->seq_len;
+    p->weight_format = h->weight_format;
+    p->lowrank_rank = h->lowrank_rank;
+    p->rope_theta = h->rope_theta > 0.0f ? h->rope_theta : 10000.0f;
+    return 0;
+}
+
+// Pointer to one part of a blob tensor, NULL if the part is absent
+static const void* blob_tensor(const uint8_t* blob, int tensor, int part) {
+    const ModelBlobHeader* h = (const ModelBlobHeader*)blob;
+    uint32_t offset = h->tensors[tensor][part].offset;
+    return offset ? blob + offset : NULL;
+}
+
+// Bytes of a tensor part in a weight format: layers matrices of d rows of
+// n weights. 0 when the format has no such part; -1 when the size varies
+// (Huffman streams)
+static int64_t part_bytes(int format, int part, int64_t layers, int64_t d, int64_t n) {
+    int64_t weights = layers * d * n;
+    switch (part) {
+    case TENSOR_PART_DATA:
+        switch (format) {
+        case WEIGHT_FORMAT_F32: return weights * 4;
+        case WEIGHT_FORMAT_Q8: return weights;
+        case WEIGHT_FORMAT_CB4: return weights / 2;
+        case WEIGHT_FORMAT_CB8: return weights;
+        case WEIGHT_FORMAT_TERNARY: return weights / 4; // two bitmasks per 32 weights
+        default: return -1;
+        }
+    case TENSOR_PART_SCALE:
+        return format == WEIGHT_FORMAT_Q8 || format == WEIGHT_FORMAT_Q8_HUFFMAN ? layers * d * 4 :
+               format == WEIGHT_FORMAT_TERNARY ? layers * 4 : 0;
+    case TENSOR_PART_CODEBOOK:
+        return format == WEIGHT_FORMAT_CB4 ? layers * 16 * 2 :
+               format == WEIGHT_FORMAT_CB8 ? layers * 256 * 2 :
+               format == WEIGHT_FORMAT_Q8_HUFFMAN ? layers * 256 : 0;
+    default:
+        return 0;
+    }
+}
+
+// Check every part of a tensor against the size the config implies.
+// Dense tensors have the parts of their format; low-rank ones (when
+// allowed) only U (d, rank) and V (rank, n)
+static int check_tensor(const ModelBlobHeader* h, int t, int format, int layers, int d, int n, int lowrank) {
+    const TensorEntry* e = h->tensors[t];
+    int is_lowrank = e[TENSOR_PART_LOWRANK_U].offset || e[TENSOR_PART_LOWRANK_V].offset;
+    int64_t rank = h->lowrank_rank;
+    for (int part = 0; part < TENSOR_PART_COUNT; part++) {
+        int64_t expected;
+        if (part == TENSOR_PART_LOWRANK_U || part == TENSOR_PART_LOWRANK_V) {
+            expected = !is_lowrank ? 0 : (part == TENSOR_PART_LOWRANK_U ? layers * d * rank : layers * rank * n) * 4;
+        } else {
+            expected = is_lowrank ? 0 : part_bytes(format, part, layers, d, n);
+        }
+        int present = e[part].offset != 0;
+        int size_ok = expected < 0 ? e[part].size > 0 && e[part].size % layers == 0 : e[part].size == expected;
+        if ((expected != 0) != present || (present && !size_ok)) {
+            printf("Model blob tensor %d/%d: %lu bytes, expected %ld\r\n", t, part,
+                   present ? (unsigned long)e[part].size : 0ul, (long)(expected < 0 ? 0 : expected));
+            return -1;
+        }
+    }
+    if (is_lowrank && (!lowrank || rank == 0)) {
+        printf("Model blob tensor %d cannot be low-rank\r\n", t);
+        return -1;
+    }
+    return 0;
+}
+
+static int check_tensors(const ModelBlobHeader* h, const Config* p) {
+    for (int t = 0; t < TENSOR_COUNT; t++) {
+        for (int part = 0; part < TENSOR_PART_COUNT; part++) {
+            const TensorEntry* e = &h->tensors[t][part];
+            if (e->offset % MODEL_BLOB_ALIGN != 0 || (uint64_t)e->offset + e->size > h->total_size ||
+                (e->offset != 0 && e->offset < sizeof(ModelBlobHeader))) {
+                printf("Model blob tensor %d/%d is misaligned or out of bounds\r\n", t, part);
+                return -1;
+            }
+        }
+    }
+    
+    int format = p->weight_format;
+    int codebook = format == WEIGHT_FORMAT_CB4 || format == WEIGHT_FORMAT_CB8;
+    int L = p->n_layers;
+    int kv_dim = CONFIG_KV_DIM(p);
+    int status = 0;
+    status |= check_tensor(h, TENSOR_TOKEN_EMBEDDING, codebook ? format : WEIGHT_FORMAT_F32, 1, p->vocab_size, p->dim, 0);
+    status |= check_tensor(h, TENSOR_RMS_ATT, WEIGHT_FORMAT_F32, L, 1, p->dim, 0);
+    status |= check_tensor(h, TENSOR_RMS_FFN, WEIGHT_FORMAT_F32, L, 1, p->dim, 0);
+    status |= check_tensor(h, TENSOR_RMS_FINAL, WEIGHT_FORMAT_F32, 1, 1, p->dim, 0);
+    status |= check_tensor(h, TENSOR_WQ, format, L, p->dim, p->dim, 0);
+    status |= check_tensor(h, TENSOR_WK, format, L, kv_dim, p->dim, 0);
+    status |= check_tensor(h, TENSOR_WV, format, L, kv_dim, p->dim, 0);
+    status |= check_tensor(h, TENSOR_WO, format, L, p->dim, p->dim, 1);
+    status |= check_tensor(h, TENSOR_W1, format, L, p->hidden_dim, p->dim, 0);
+    status |= check_tensor(h, TENSOR_W2, format, L, p->dim, p->hidden_dim, 1);
+    status |= check_tensor(h, TENSOR_W3, format, L, p->hidden_dim, p->dim, 0);
+    
+    // No WCLS at all: the classifier shares the embedding
+    int has_wcls = 0;
+    for (int part = 0; part < TENSOR_PART_COUNT; part++) {
+        has_wcls |= h->tensors[TENSOR_WCLS][part].offset != 0;
+    }
+    if (has_wcls) {
+        status |= check_tensor(h, TENSOR_WCLS, format, 1, p->vocab_size, p->dim, 1);
+    }
+    return status;
+}
+
+int memory_map_weights(TransformerWeights *w, Config* p, const uint8_t* blob) {
+    // Map model weights in place: every tensor pointer is blob + offset,
+    // so nothing is copied and weights are read straight from ROM/QSPI
     printf("Mapping model weights from memory...\r\n");
     
-    // For demo, use placeholder pointers
-    static float dummy_weights[1000]; // Placeholder
+    // Every tensor the forward pass reads must be there with the size the
+    // config implies, the kernels do no bounds checks of their own
+    const ModelBlobHeader* h = (const ModelBlobHeader*)blob;
+    if (check_tensors(h, p) != 0) {
+        return -1;
+    }
+    
+    // Norm weights are always fp32
+    w->rms_att_weight = (float*)blob_tensor(blob, TENSOR_RMS_ATT, TENSOR_PART_DATA);
+    w->rms_ffn_weight = (float*)blob_tensor(blob, TENSOR_RMS_FFN, TENSOR_PART_DATA);
+    w->rms_final_weight = (float*)blob_tensor(blob, TENSOR_RMS_FINAL, TENSOR_PART_DATA);
+    
+    // fp32 tensors, NULL for projections stored in a quantized format
+    int f32 = p->weight_format == WEIGHT_FORMAT_F32;
+    int codebook = p->weight_format == WEIGHT_FORMAT_CB4 || p->weight_format == WEIGHT_FORMAT_CB8;
+    w->token_embedding_table = codebook ? NULL : (float*)blob_tensor(blob, TENSOR_TOKEN_EMBEDDING, TENSOR_PART_DATA);
+    w->wq = f32 ? (float*)blob_tensor(blob, TENSOR_WQ, TENSOR_PART_DATA) : NULL;
+    w->wk = f32 ? (float*)blob_tensor(blob, TENSOR_WK, TENSOR_PART_DATA) : NULL;
+    w->wv = f32 ? (float*)blob_tensor(blob, TENSOR_WV, TENSOR_PART_DATA) : NULL;
+    w->wo = f32 ? (float*)blob_tensor(blob, TENSOR_WO, TENSOR_PART_DATA) : NULL;
+    w->w1 = f32 ? (float*)blob_tensor(blob, TENSOR_W1, TENSOR_PART_DATA) : NULL;
+    w->w2 = f32 ? (float*)blob_tensor(blob, TENSOR_W2, TENSOR_PART_DATA) : NULL;
+    w->w3 = f32 ? (float*)blob_tensor(blob, TENSOR_W3, TENSOR_PART_DATA) : NULL;
+    w->wcls = f32 ? (float*)blob_tensor(blob, TENSOR_WCLS, TENSOR_PART_DATA) : NULL;
+    
+    // Quantized projections
+    QuantizedTensor* q[TENSOR_COUNT] = { 0 };
+    q[TENSOR_WQ] = &w->wq_q;
+    q[TENSOR_WK] = &w->wk_q;
+    q[TENSOR_WV] = &w->wv_q;
+    q[TENSOR_WO] = &w->wo_q;
+    q[TENSOR_W1] = &w->w1_q;
+    q[TENSOR_W2] = &w->w2_q;
+    q[TENSOR_W3] = &w->w3_q;
+    q[TENSOR_WCLS] = &w->wcls_q;
+    q[TENSOR_TOKEN_EMBEDDING] = codebook ? &w->token_embedding_q : NULL;
+    for (int t = 0; t < TENSOR_COUNT; t++) {
+        if (q[t] && !f32) {
+            q[t]->data = blob_tensor(blob, t, TENSOR_PART_DATA);
+            q[t]->scale = (const float*)blob_tensor(blob, t, TENSOR_PART_SCALE);
+            q[t]->codebook = (const uint16_t*)blob_tensor(blob, t, TENSOR_PART_CODEBOOK);
+            int layers = (t == TENSOR_WCLS || t == TENSOR_TOKEN_EMBEDDING) ? 1 : p->n_layers;
+            q[t]->layer_bytes = h->tensors[t][TENSOR_PART_DATA].size / layers;
+            q[t]->lut = NULL;
+        }
+    }
+    
+    // Classifier shares the token embedding when the blob has no WCLS. Only
+    // codebook formats quantize the embedding, the others keep it fp32 and
+    // the classifier then runs in fp32 too
+    if (!blob_tensor(blob, TENSOR_WCLS, TENSOR_PART_DATA)) {
+        if (codebook) {
+            w->wcls_q = w->token_embedding_q;
+        } else {
+            w->wcls = w->token_embedding_table;
+            w->wcls_q = (QuantizedTensor){ 0 };
+        }
+    }
+    
+    // Low-rank factors, NULL keeps the projection dense
+    w->wo_u = (float*)blob_tensor(blob, TENSOR_WO, TENSOR_PART_LOWRANK_U);
+    w->wo_v = (float*)blob_tensor(blob, TENSOR_WO, TENSOR_PART_LOWRANK_V);
+    w->w2_u = (float*)blob_tensor(blob, TENSOR_W2, TENSOR_PART_LOWRANK_U);
+    w->w2_v = (float*)blob_tensor(blob, TENSOR_W2, TENSOR_PART_LOWRANK_V);
+    w->wcls_u = (float*)blob_tensor(blob, TENSOR_WCLS, TENSOR_PART_LOWRANK_U);
+    w->wcls_v = (float*)blob_tensor(blob, TENSOR_WCLS, TENSOR_PART_LOWRANK_V);
+    w->stream = NULL;
+    
+    if (p->weight_format == WEIGHT_FORMAT_Q8_HUFFMAN && huffman_init(w, p) != 0) {
+        return -1;
+    }
     
-    w->token_embedding_table = dummy_weights;
-    w->rms_att_weight = dummy_weights;
-    w->rms_ffn_weight = dummy_weights;
-    w->wq = dummy_weights;
-    w->wk = dummy_weights;
-    w->wv = dummy_weights;
-    w->wo = dummy_weights;
-    w->w1 = dummy_weights;
-    w->w2 = dummy_weights;
-    w->w3 = dummy_weights;
-    w->rms_final_weight = dummy_weights;
-    w->wcls = dummy_weights;
+    printf("Model blob mapped: %lu bytes at %p\r\n", (unsigned long)h->total_size, (const void*)blob);
+    return 0;
 }
 
 unsigned long long time_in_ms() {
@@ -79,7 +377,8 @@ unsigned int random_u32(unsigned long long *state) {
 }
 
 float random_f32(unsigned long long *state) {
-    return (random_u32(state) >> 5) * 0x1.0p-27f;
+    // random_u32() gives 15 bits
+    return random_u32(state) * (1.0f / 32768.0f);
 }
 
 int argmax(float* probabilities, int n) {
@@ -94,6 +393,23 @@ int argmax(float* probabilities, int n) {
     return max_i;
 }
 
+uint32_t crc32_update(uint32_t crc, const void* data, size_t size) {
+    // Four bits at a time through a 16-entry table: small enough for flash,
+    // and only used off the hot path (load-time checks)
+    static const uint32_t table[16] = {
+        0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu, 0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+        0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu, 0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu,
+    };
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ table[crc & 15];
+        crc = (crc >> 4) ^ table[crc & 15];
+    }
+    return ~crc;
+}
+
 // Custom math functions for embedded systems without full math library
 float fminf_custom(float a, float b) {
     return (a < b) ? a : b;
@@ -104,18 +420,25 @@ float fmaxf_custom(float a, float b) {
 }
 
 float expf_custom(float x) {
-    // Simple approximation for exp(x)
-    if (x > 10.0f) return 22026.4657948f; // e^10
-    if (x < -10.0f) return 0.0000454f;    // e^-10
+    // exp(x) = 2^k * exp(r) with |r| <= ln2/2, so the Taylor series stays
+    // accurate over the whole range (softmax feeds it large negative values)
+    if (x > 88.0f) return 1.6516363e38f; // e^88
+    if (x < -87.0f) return 0.0f;
+    
+    int k = (int)(x * 1.44269504f + (x >= 0.0f ? 0.5f : -0.5f));
+    float r = x - (float)k * 0.69314718f;
     
-    // Taylor series approximation
     float result = 1.0f;
     float term = 1.0f;
-    for (int i = 1; i < 10; i++) {
-        term *= x / i;
+    for (int i = 1; i < 8; i++) {
+        term *= r / i;
         result += term;
     }
-    return result;
+    
+    // Scale by 2^k through the exponent bits
+    union { float f; uint32_t u; } scale;
+    scale.u = (uint32_t)(k + 127) << 23;
+    return result * scale.f;
 }
 
 float sqrtf_custom(float x) {
@@ -128,3 +451,66 @@ float sqrtf_custom(float x) {
     }
     return guess;
 }
+
+float logf_custom(float x) {
+    if (x <= 0.0f) return -88.0f;
+    
+    // x = m * 2^e with m in [sqrt(2)/2, sqrt(2)], ln(m) = 2 atanh((m - 1) / (m + 1))
+    union { float f; uint32_t u; } v;
+    v.f = x;
+    int e = (int)((v.u >> 23) & 0xFFu) - 127;
+    v.u = (v.u & 0x7FFFFFu) | 0x3F800000u;
+    float m = v.f;
+    if (m > 1.41421356f) {
+        m *= 0.5f;
+        e++;
+    }
+    float t = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+    float series = 1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9))));
+    return (float)e * 0.69314718f + 2.0f * t * series;
+}
+
+void sincosf_custom(float x, float* s, float* c) {
+    // x = q * pi/2 + r with |r| <= pi/4 (pi/2 split in two so r keeps its
+    // precision for large x), then short Taylor series of r
+    float fq = x * 0.63661977f;
+    int q = (int)(fq + (fq >= 0.0f ? 0.5f : -0.5f));
+    float r = x - (float)q * 1.5703125f - (float)q * 4.8382679e-4f;
+    float r2 = r * r;
+    float sr = r * (1.0f - r2 / 6 * (1.0f - r2 / 20 * (1.0f - r2 / 42 * (1.0f - r2 / 72))));
+    float cr = 1.0f - r2 / 2 * (1.0f - r2 / 12 * (1.0f - r2 / 30 * (1.0f - r2 / 56)));
+    switch (q & 3) {
+        case 0: *s = sr; *c = cr; break;
+        case 1: *s = cr; *c = -sr; break;
+        case 2: *s = -sr; *c = -cr; break;
+        default: *s = -cr; *c = sr; break;
+    }
+}
+
+float fp16_to_f32(uint16_t h) {
+    // IEEE 754 half -> single, including subnormals and inf/nan
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1Fu;
+    uint32_t mant = h & 0x3FFu;
+    uint32_t bits;
+
+    if (exp == 0x1Fu) {
+        bits = sign | 0x7F800000u | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112u) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        bits = sign;
+    } else {
+        // Subnormal: renormalize the mantissa
+        exp = 113;
+        while ((mant & 0x400u) == 0) {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3FFu) << 13);
+    }
+
+    union { uint32_t u; float f; } conv = { bits };
+    return conv.f;
+}
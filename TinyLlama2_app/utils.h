@@ -9,18 +9,24 @@
 #include "tinyllama2.h"
 
 // Utility functions
-void malloc_run_state(RunState* s, Config* p);
+int malloc_run_state(RunState* s, Config* p);
 void free_run_state(RunState* s);
-void memory_map_weights(TransformerWeights *w, Config* p, float* ptr, int shared_weights);
+int read_model_config(Config* p, const uint8_t* blob);
+int memory_map_weights(TransformerWeights *w, Config* p, const uint8_t* blob);
 unsigned long long time_in_ms();
 unsigned int random_u32(unsigned long long *state);
 float random_f32(unsigned long long *state);
 int argmax(float* probabilities, int n);
+// CRC-32 (zlib polynomial) of data, continuing from crc (0 to start)
+uint32_t crc32_update(uint32_t crc, const void* data, size_t size);
 
 // Math utilities
 float fminf_custom(float a, float b);
 float fmaxf_custom(float a, float b);
 float expf_custom(float x);
 float sqrtf_custom(float x);
+float logf_custom(float x);
+void sincosf_custom(float x, float* s, float* c);
+float fp16_to_f32(uint16_t h);
 
 #endif // UTILS_H
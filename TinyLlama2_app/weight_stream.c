@@ -0,0 +1,170 @@
+#include "weight_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+// ISRAM tile slots, filled before use so not zeroed at boot
+static uint8_t stream_buffer[2][WEIGHT_STREAM_TILE_BYTES] NOINIT __attribute__((aligned(MODEL_BLOB_ALIGN)));
+
+// Projections in the order the forward pass consumes them
+static const int stream_order[] = {
+    TENSOR_WQ, TENSOR_WK, TENSOR_WV, TENSOR_WO, TENSOR_W1, TENSOR_W3, TENSOR_W2
+};
+#define STREAM_TENSORS (int)(sizeof(stream_order) / sizeof(stream_order[0]))
+
+// Add one tensor part of rows rows per layer to the schedule
+static int add_part(WeightStream* ws, const ModelBlobHeader* h, int tensor, int part, int rows) {
+    const TensorEntry* e = &h->tensors[tensor][part];
+    uint32_t slice = e->size / ws->n_layers;
+    if (e->size % ws->n_layers != 0 || slice % rows != 0) {
+        printf("Tensor %d part %d does not split into %d layers of %d rows\r\n", tensor, part, ws->n_layers, rows);
+        return -1;
+    }
+    uint32_t row_bytes = slice / rows;
+    if (row_bytes > WEIGHT_STREAM_TILE_BYTES) {
+        printf("Tensor %d rows (%lu bytes) exceed the stream tile (%lu bytes)\r\n", tensor,
+               (unsigned long)row_bytes, (unsigned long)WEIGHT_STREAM_TILE_BYTES);
+        return -1;
+    }
+    int tile_rows = (int)(WEIGHT_STREAM_TILE_BYTES / row_bytes);
+    ws->parts[ws->n_parts++] = (WeightStreamPart){
+        tensor, part, rows, tile_rows < rows ? tile_rows : rows, e->offset, row_bytes
+    };
+    return 0;
+}
+
+int weight_stream_init(WeightStream* ws, TransformerWeights* w, Config* p, const uint8_t* blob) {
+    const ModelBlobHeader* h = (const ModelBlobHeader*)blob;
+    if (p->weight_format == WEIGHT_FORMAT_Q8_HUFFMAN) {
+        printf("Weight streaming: Q8_HUFFMAN layers are decoded in place\r\n");
+        return 0;
+    }
+
+    ws->blob = blob;
+    ws->n_layers = p->n_layers;
+    ws->n_parts = 0;
+
+    // Output rows of each projection; low-rank ones run V (rank rows) then U
+    uint32_t layer_bytes = 0;
+    for (int i = 0; i < STREAM_TENSORS; i++) {
+        int t = stream_order[i];
+        int d = t == TENSOR_WK || t == TENSOR_WV ? CONFIG_KV_DIM(p) :
+                t == TENSOR_W1 || t == TENSOR_W3 ? p->hidden_dim : p->dim;
+        int status;
+        if (h->tensors[t][TENSOR_PART_LOWRANK_U].offset) {
+            status = add_part(ws, h, t, TENSOR_PART_LOWRANK_V, p->lowrank_rank);
+            if (status == 0) {
+                status = add_part(ws, h, t, TENSOR_PART_LOWRANK_U, d);
+            }
+        } else {
+            status = add_part(ws, h, t, TENSOR_PART_DATA, d);
+        }
+        if (status != 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < ws->n_parts; i++) {
+        layer_bytes += ws->parts[i].row_bytes * ws->parts[i].rows;
+    }
+
+    for (int slot = 0; slot < 2; slot++) {
+        ws->buffer[slot] = stream_buffer[slot];
+        ws->slot_valid[slot] = 0;
+        ws->slot_bytes[slot] = 0;
+        ws->bytes_done[slot] = 0;
+    }
+    w->stream = ws;
+
+    printf("Weight streaming: %lu bytes per layer, 2 x %lu byte ISRAM tiles\r\n",
+           (unsigned long)layer_bytes, (unsigned long)WEIGHT_STREAM_TILE_BYTES);
+    return 0;
+}
+
+int weight_stream_has(const WeightStream* ws, int tensor, int part) {
+    for (int i = 0; i < ws->n_parts; i++) {
+        if (ws->parts[i].tensor == tensor && ws->parts[i].part == part) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Tile after pos in consumption order, wrapping to layer 0 of the next token
+static WeightStreamPos next_pos(const WeightStream* ws, WeightStreamPos pos) {
+    pos.row0 += ws->parts[pos.part].tile_rows;
+    if (pos.row0 >= ws->parts[pos.part].rows) {
+        pos.row0 = 0;
+        if (++pos.part == ws->n_parts) {
+            pos.part = 0;
+            pos.layer = (pos.layer + 1) % ws->n_layers;
+        }
+    }
+    return pos;
+}
+
+static int slot_holds(const WeightStream* ws, int slot, WeightStreamPos pos) {
+    const WeightStreamPos* s = &ws->slot_pos[slot];
+    return ws->slot_valid[slot] && s->layer == pos.layer && s->part == pos.part && s->row0 == pos.row0;
+}
+
+static void wait_slot(WeightStream* ws, int slot) {
+    while (ws->bytes_done[slot] < ws->slot_bytes[slot]) {
+        weight_stream_idle();
+    }
+}
+
+// Queue one tile into a slot, once the slot's previous transfer is over
+static void stream_fill(WeightStream* ws, int slot, WeightStreamPos pos) {
+    const WeightStreamPart* part = &ws->parts[pos.part];
+    int rows = part->rows - pos.row0 < part->tile_rows ? part->rows - pos.row0 : part->tile_rows;
+    uint32_t size = (uint32_t)rows * part->row_bytes;
+    const uint8_t* src = ws->blob + part->offset +
+                         ((size_t)pos.layer * part->rows + pos.row0) * part->row_bytes;
+
+    wait_slot(ws, slot);
+    ws->slot_pos[slot] = pos;
+    ws->slot_valid[slot] = 1;
+    ws->slot_bytes[slot] = size;
+    ws->bytes_done[slot] = 0;
+    weight_stream_transfer(ws, slot, ws->buffer[slot], src, size);
+}
+
+const uint8_t* weight_stream_rows(WeightStream* ws, int layer, int tensor, int part, int row0, int* rows) {
+    WeightStreamPos pos = { layer, 0, row0 };
+    while (pos.part < ws->n_parts &&
+           (ws->parts[pos.part].tensor != tensor || ws->parts[pos.part].part != part)) {
+        pos.part++;
+    }
+    if (pos.part == ws->n_parts) {
+        return NULL;
+    }
+
+    // Normally already in flight from the previous call; out of order, it
+    // is fetched now
+    int slot = slot_holds(ws, 1, pos) ? 1 : 0;
+    if (!slot_holds(ws, slot, pos)) {
+        stream_fill(ws, slot, pos);
+    }
+
+    // The other slot's tile has been used: the next one goes there
+    WeightStreamPos next = next_pos(ws, pos);
+    if (!slot_holds(ws, !slot, next)) {
+        stream_fill(ws, !slot, next);
+    }
+
+    wait_slot(ws, slot);
+    const WeightStreamPart* p = &ws->parts[pos.part];
+    *rows = p->rows - row0 < p->tile_rows ? p->rows - row0 : p->tile_rows;
+    return ws->buffer[slot];
+}
+
+void weight_stream_transfer_done(WeightStream* ws, int slot, const void* end) {
+    ws->bytes_done[slot] = (uint32_t)((const uint8_t*)end - ws->buffer[slot]);
+}
+
+__attribute__((weak)) void weight_stream_transfer(WeightStream* ws, int slot, void* dst, const void* src, uint32_t size) {
+    memcpy(dst, src, size);
+    weight_stream_transfer_done(ws, slot, (uint8_t*)dst + size);
+}
+
+__attribute__((weak)) void weight_stream_idle(void) {
+}
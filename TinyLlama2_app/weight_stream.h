@@ -0,0 +1,76 @@
+#ifndef WEIGHT_STREAM_H
+#define WEIGHT_STREAM_H
+
+#include "tinyllama2.h"
+#include "model_blob.h"
+
+// Streams the per-layer projection weights from slow memory (QSPI / RAM3)
+// through two ISRAM tile slots, so the model may be far larger than ISRAM:
+// only WEIGHT_STREAM_TILE_BYTES x 2 are resident, whatever the layer size.
+// Each projection is computed one row tile at a time, in the order the
+// forward pass consumes them, and the following tile is queued into the
+// other slot before the current one is used. Scales, codebooks and norm
+// weights are small and read in place. Q8_HUFFMAN layers are single
+// bitstreams that cannot be split by row; they are decoded in place.
+//
+// With the default transfer backend (a synchronous memcpy) the next tile
+// is copied before the current one is computed, so nothing overlaps yet;
+// a DMA driver that overrides the transfer hooks below gets the overlap.
+
+#ifndef WEIGHT_STREAM_TILE_BYTES
+#define WEIGHT_STREAM_TILE_BYTES 16384  // per slot; must hold one weight row
+#endif
+
+// Most per-layer tensor parts streamed per layer (7 projections, two of
+// them as low-rank pairs)
+#define WEIGHT_STREAM_MAX_PARTS 9
+
+// One streamed tensor part: per layer, rows of row_bytes back to back
+typedef struct {
+    int tensor;
+    int part;
+    int rows;            // rows per layer
+    int tile_rows;       // rows per tile
+    uint32_t offset;     // blob offset of layer 0
+    uint32_t row_bytes;
+} WeightStreamPart;
+
+// Position in the stream: tile at row0 of parts[part] in layer
+typedef struct {
+    int layer;
+    int part;
+    int row0;
+} WeightStreamPos;
+
+typedef struct WeightStream {
+    const uint8_t* blob;              // source blob in slow memory
+    int n_layers;
+    int n_parts;
+    WeightStreamPart parts[WEIGHT_STREAM_MAX_PARTS]; // in consumption order
+    uint8_t* buffer[2];               // ISRAM tile slots
+    WeightStreamPos slot_pos[2];      // tile held or in flight per slot
+    int slot_valid[2];
+    uint32_t slot_bytes[2];           // size of that tile
+    volatile uint32_t bytes_done[2];  // bytes of each slot already transferred
+} WeightStream;
+
+// Set up streaming for weights mapped from blob; sets w->stream, or leaves
+// it NULL for a model that is not streamed (Q8_HUFFMAN)
+int weight_stream_init(WeightStream* ws, TransformerWeights* w, Config* p, const uint8_t* blob);
+
+// 1 if the streamed layers hold this tensor part
+int weight_stream_has(const WeightStream* ws, int tensor, int part);
+
+// Rows row0 .. row0 + *rows - 1 of one layer's tensor part, in ISRAM.
+// Queues the following tile into the other slot, then waits for this one.
+// The previous tile is released: call once per tile, in order.
+const uint8_t* weight_stream_rows(WeightStream* ws, int layer, int tensor, int part, int row0, int* rows);
+
+// Transfer backend. The default copies synchronously with memcpy; a DMA
+// driver overrides these weak hooks, queues the copy and reports progress
+// with weight_stream_transfer_done() from its completion interrupt.
+void weight_stream_transfer(WeightStream* ws, int slot, void* dst, const void* src, uint32_t size);
+void weight_stream_idle(void);
+void weight_stream_transfer_done(WeightStream* ws, int slot, const void* end);
+
+#endif // WEIGHT_STREAM_H
@@ -0,0 +1,101 @@
+// TinyLlama2 KV Snapshot Builder
+// Runs the model over SYSTEM_PROMPT on the host and writes the resulting
+// KV cache as a const blob (kv_snapshot_data.c), so the firmware starts
+// every session from it instead of prefilling the prompt.
+//
+// Build against the same model_weights.c the firmware links:
+//   gcc -O2 -ITinyLlama2_app -o build_kv_snapshot scripts/build_kv_snapshot.c $(ls TinyLlama2_app/*.c | grep -v main.c) -lm
+//   ./build_kv_snapshot TinyLlama2_app/kv_snapshot_data.c [model.bin]
+// With a model.bin from extract_weights.py --bin, that blob is mapped instead
+// of the linked-in one; it must be the blob the firmware links.
+
+#include "tinyllama2.h"
+#include "transformer.h"
+#include "tokenizer.h"
+#include "model_blob.h"
+#include "kv_cache.h"
+#include "kv_snapshot.h"
+#include <stdio.h>
+#include <string.h>
+
+static Transformer transformer;
+static Tokenizer tokenizer;
+
+static void write_bytes(FILE* f, const void* data, size_t size, size_t* column) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        fprintf(f, "%s0x%02x,", *column == 0 ? "    " : " ", bytes[i]);
+        if (++*column == 16) {
+            fprintf(f, "\n");
+            *column = 0;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* output_file = argc > 1 ? argv[1] : "kv_snapshot_data.c";
+    const char* checkpoint_path = argc > 2 ? argv[2] : NULL;
+    
+    printf("TinyLlama2 KV Snapshot Builder\n");
+    printf("==============================\n");
+    if (build_transformer(&transformer, checkpoint_path) != 0 ||
+        build_tokenizer(&tokenizer, NULL, transformer.config.vocab_size) != 0) {
+        return 1;
+    }
+    Config* p = &transformer.config;
+    RunState* s = &transformer.state;
+    
+    // Prefill exactly as the firmware would
+    static int tokens[sizeof(SYSTEM_PROMPT) + 2];
+    int n_tokens = 0;
+    encode(&tokenizer, SYSTEM_PROMPT, 1, 0, tokens, &n_tokens);
+    if (n_tokens >= p->seq_len) {
+        printf("System prompt of %d tokens does not fit seq_len %d\n", n_tokens, p->seq_len);
+        return 1;
+    }
+    for (int pos = 0; pos < n_tokens; pos++) {
+        if (!forward(&transformer, tokens[pos], pos)) {
+            return 1;
+        }
+    }
+    
+    KVSnapshotHeader h = {
+        .magic = KV_SNAPSHOT_MAGIC,
+        .version = KV_SNAPSHOT_VERSION,
+        .model_hash = kv_snapshot_hash(transformer.data, sizeof(ModelBlobHeader)),
+        .prompt_hash = kv_snapshot_hash(SYSTEM_PROMPT, strlen(SYSTEM_PROMPT)),
+        .n_layers = p->n_layers,
+        .kv_dim = CONFIG_KV_DIM(p),
+        .n_pos = n_tokens,
+    };
+    size_t total = sizeof(h) + n_tokens * sizeof(int32_t) +
+                   (size_t)n_tokens * p->n_layers * 2 * h.kv_dim * sizeof(float);
+    
+    FILE* f = fopen(output_file, "w");
+    if (!f) {
+        printf("Cannot open %s\n", output_file);
+        return 1;
+    }
+    fprintf(f, "// KV cache snapshot of SYSTEM_PROMPT\n");
+    fprintf(f, "// Generated automatically by scripts/build_kv_snapshot.c\n\n");
+    fprintf(f, "#include \"kv_snapshot.h\"\n\n");
+    fprintf(f, "static const uint8_t kv_snapshot_data[%zu] __attribute__((aligned(16))) = {\n", total);
+    size_t column = 0;
+    write_bytes(f, &h, sizeof(h), &column);
+    for (int pos = 0; pos < n_tokens; pos++) {
+        int32_t token = tokens[pos];
+        write_bytes(f, &token, sizeof(token), &column);
+    }
+    for (int pos = 0; pos < n_tokens; pos++) {
+        for (int layer = 0; layer < p->n_layers; layer++) {
+            write_bytes(f, kv_key(s->kv, layer, pos), h.kv_dim * sizeof(float), &column);
+            write_bytes(f, kv_value(s->kv, layer, pos), h.kv_dim * sizeof(float), &column);
+        }
+    }
+    fprintf(f, "%s};\n\n", column ? "\n" : "");
+    fprintf(f, "const uint8_t* const kv_snapshot = kv_snapshot_data;\n");
+    fclose(f);
+    
+    printf("Wrote %d positions (%zu bytes) to %s\n", n_tokens, total, output_file);
+    return 0;
+}
@@ -0,0 +1,124 @@
+// TinyLlama2 Prompt Cache Builder
+// Tokenizes the questions the demo asks (the lists in demo_questions.c,
+// shared with main.c) and writes them as const tables
+// (prompt_cache_data.c), so the firmware finds their tokens without
+// running encode(). Extra prompts can be given after the output file.
+//
+// Built and run by build_prompt_cache.sh before each firmware build, or by
+// hand against the same tokenizer_data.c the firmware links:
+//   gcc -O2 -ITinyLlama2_app -o build_prompt_cache scripts/build_prompt_cache.c $(ls TinyLlama2_app/*.c | grep -v main.c) -lm
+//   ./build_prompt_cache TinyLlama2_app/prompt_cache_data.c ["extra prompt" ...]
+
+#include "tinyllama2.h"
+#include "tokenizer.h"
+#include "model_blob.h"
+#include "utils.h"
+#include "prompt_cache.h"
+#include "demo_questions.h"
+#include <stdio.h>
+#include <string.h>
+
+static Tokenizer tokenizer;
+
+#define MAX_PROMPTS 64
+
+static PromptCacheRecord records[MAX_PROMPTS];
+static char texts[MAX_PROMPTS][PROMPT_CACHE_MAX_TEXT];
+static int32_t tokens[MAX_PROMPTS * PROMPT_CACHE_MAX_TOKENS];
+static int n_records;
+static int n_tokens;
+
+static void write_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (const unsigned char* c = (const unsigned char*)s; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(f, "\\%c", *c);
+        } else if (*c < 32 || *c >= 127) {
+            fprintf(f, "\\%03o", *c);
+        } else {
+            fputc(*c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Encode one prompt exactly as prompt_cache_get() would and add its record
+static void add_prompt(const char* prompt) {
+    if (n_records == MAX_PROMPTS) {
+        printf("More than %d prompts, skipping \"%s\"\n", MAX_PROMPTS, prompt);
+        return;
+    }
+    char* text = texts[n_records];
+    if (prompt_normalize(prompt, text, PROMPT_CACHE_MAX_TEXT) < 0) {
+        printf("Skipping \"%s\": longer than %d bytes\n", prompt, PROMPT_CACHE_MAX_TEXT - 1);
+        return;
+    }
+    uint32_t key = prompt_key(text);
+    for (int j = 0; j < n_records; j++) {
+        if (records[j].key == key && strcmp(records[j].text, text) == 0) {
+            return;
+        }
+    }
+    static int encoded[PROMPT_CACHE_MAX_TEXT + 2];
+    int n = 0;
+    encode(&tokenizer, text, 0, 0, encoded, &n);
+    if (n > PROMPT_CACHE_MAX_TOKENS) {
+        printf("Skipping \"%s\": more than %d tokens\n", prompt, PROMPT_CACHE_MAX_TOKENS);
+        return;
+    }
+    records[n_records] = (PromptCacheRecord){ key, (uint16_t)n_tokens, (uint16_t)n, text };
+    for (int j = 0; j < n; j++) {
+        tokens[n_tokens++] = encoded[j];
+    }
+    n_records++;
+}
+
+int main(int argc, char** argv) {
+    const char* output_file = argc > 1 ? argv[1] : "prompt_cache_data.c";
+
+    printf("TinyLlama2 Prompt Cache Builder\n");
+    printf("===============================\n");
+    Config config;
+    if (read_model_config(&config, model_blob) != 0 ||
+        build_tokenizer(&tokenizer, NULL, config.vocab_size) != 0) {
+        return 1;
+    }
+
+    // The demo's questions, then the extra prompts
+    for (int l = 0; l < demo_question_list_count; l++) {
+        for (int i = 0; i < demo_question_lists[l]->count; i++) {
+            add_prompt(demo_question_lists[l]->questions[i]);
+        }
+    }
+    for (int i = 2; i < argc; i++) {
+        add_prompt(argv[i]);
+    }
+
+    FILE* f = fopen(output_file, "w");
+    if (!f) {
+        printf("Cannot open %s\n", output_file);
+        return 1;
+    }
+    fprintf(f, "// Build-time prompt cache for TinyLlama2\n");
+    fprintf(f, "// Generated automatically by scripts/build_prompt_cache.c\n\n");
+    fprintf(f, "#include \"prompt_cache.h\"\n\n");
+    fprintf(f, "static const int32_t prompt_tokens[%d] = {\n", n_tokens > 0 ? n_tokens : 1);
+    for (int i = 0; i < n_tokens; i++) {
+        fprintf(f, "%s%d,%s", i % 16 == 0 ? "    " : " ", tokens[i], i % 16 == 15 || i == n_tokens - 1 ? "\n" : "");
+    }
+    fprintf(f, "};\n\n");
+    fprintf(f, "static const PromptCacheRecord prompt_records[%d] = {\n", n_records > 0 ? n_records : 1);
+    for (int i = 0; i < n_records; i++) {
+        fprintf(f, "    { 0x%08xu, %u, %u, ", records[i].key, records[i].offset, records[i].n_tokens);
+        write_string(f, records[i].text);
+        fprintf(f, " },\n");
+    }
+    fprintf(f, "};\n\n");
+    fprintf(f, "const PromptCacheTable prompt_cache_table = {\n");
+    fprintf(f, "    0x%08xu, %d, prompt_records, prompt_tokens\n", prompt_cache_tokenizer_id(&tokenizer), n_records);
+    fprintf(f, "};\n");
+    fclose(f);
+
+    printf("Wrote %d prompts (%d tokens) to %s\n", n_records, n_tokens, output_file);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/sh
+# Regenerate the build-time prompt cache (TinyLlama2_app/prompt_cache_data.c)
+# with the host compiler. The builder links the firmware's own tokenizer,
+# tokenizer_data.c and demo question lists, so the table always matches
+# what the firmware would encode. Run by the TinyLlama2_app build before
+# compiling; by hand: scripts/build_prompt_cache.sh [output.c] ["extra prompt" ...]
+
+set -e
+
+scripts="$(dirname "$0")"
+app="$scripts/../TinyLlama2_app"
+output="${1:-$app/prompt_cache_data.c}"
+[ $# -gt 0 ] && shift
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+${HOST_CC:-cc} -O2 -I"$app" -o "$tmp/build_prompt_cache" "$scripts/build_prompt_cache.c" \
+    $(ls "$app"/*.c | grep -v '/main\.c$') -lm
+"$tmp/build_prompt_cache" "$output" "$@"
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+TinyLlama2 Response Index Builder
+Compiles the keyword -> response list (qa_responses.txt) into an Aho-Corasick
+automaton as const C tables (response_index_data.c, layout in response_index.h)
+"""
+
+import argparse
+import os
+from collections import deque
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+def parse_responses(path):
+    """Return ([(keywords, response)] in priority order, fallback response)"""
+    entries = []
+    fallback = ""
+    with open(path, encoding='utf-8') as f:
+        for line_no, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            if '=>' not in line:
+                raise ValueError(f"{path}:{line_no}: expected 'keyword | keyword => response'")
+            keys, response = (part.strip() for part in line.split('=>', 1))
+            if keys == '*':
+                fallback = response
+                continue
+            # Questions are lowercased before the scan
+            keywords = [k.strip().lower() for k in keys.split('|') if k.strip()]
+            if not keywords:
+                raise ValueError(f"{path}:{line_no}: no keywords")
+            entries.append((keywords, response))
+    return entries, fallback
+
+def build_automaton(entries):
+    """Trie of every keyword with fail links; match[s] is the lowest response id
+    of any keyword that ends at s or at one of its suffix states"""
+    children = [{}]
+    match = [-1]
+    for response_id, (keywords, _) in enumerate(entries):
+        for keyword in keywords:
+            s = 0
+            for c in keyword.encode('utf-8'):
+                if c not in children[s]:
+                    children[s][c] = len(children)
+                    children.append({})
+                    match.append(-1)
+                s = children[s][c]
+            if match[s] < 0 or response_id < match[s]:
+                match[s] = response_id
+
+    # Breadth first, so a state's fail target is finished before it
+    fail = [0] * len(children)
+    queue = deque(children[0].values())
+    while queue:
+        s = queue.popleft()
+        if match[fail[s]] >= 0 and (match[s] < 0 or match[fail[s]] < match[s]):
+            match[s] = match[fail[s]]
+        for c, child in children[s].items():
+            f = fail[s]
+            while f and c not in children[f]:
+                f = fail[f]
+            fail[child] = children[f][c] if c in children[f] else 0
+            queue.append(child)
+    return children, fail, match
+
+def write_array(f, ctype, name, values, per_line=16):
+    f.write(f"static const {ctype} {name}[{max(len(values), 1)}] = {{\n")
+    for i in range(0, len(values), per_line):
+        f.write("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",\n")
+    f.write("};\n\n")
+
+def c_string(s):
+    out = '"'
+    for b in s.encode('utf-8'):
+        ch = chr(b)
+        if ch in '"\\':
+            out += '\\' + ch
+        elif 32 <= b < 127:
+            out += ch
+        else:
+            out += f'\\{b:03o}'
+    return out + '"'
+
+def generate_response_index_file(entries, fallback, output_file):
+    children, fail, match = build_automaton(entries)
+    if len(entries) > 0x7FFF:
+        raise ValueError("more responses than int16_t match ids can hold")
+
+    # Root transitions as a full table, every other state as sorted edges
+    root = [children[0].get(c, 0) for c in range(256)]
+    first_edge = [0]
+    edge_byte = []
+    edge_next = []
+    for s, edges in enumerate(children):
+        if s:
+            for c in sorted(edges):
+                edge_byte.append(c)
+                edge_next.append(edges[c])
+        first_edge.append(len(edge_byte))
+
+    with open(output_file, 'w', encoding='utf-8') as f:
+        f.write("// TinyLlama2 canned-response keyword index\n")
+        f.write("// Generated automatically by scripts/build_response_index.py\n\n")
+        f.write("#include \"response_index.h\"\n\n")
+        write_array(f, "uint32_t", "index_root", root)
+        write_array(f, "uint32_t", "index_first_edge", first_edge)
+        write_array(f, "uint8_t", "index_edge_byte", edge_byte)
+        write_array(f, "uint32_t", "index_edge_next", edge_next)
+        write_array(f, "uint32_t", "index_fail", fail)
+        write_array(f, "int16_t", "index_match", match)
+        f.write(f"static const char* const index_responses[{max(len(entries), 1)}] = {{\n")
+        for _, response in entries:
+            f.write(f"    {c_string(response)},\n")
+        f.write("};\n\n")
+        f.write("const ResponseIndex response_index = {\n")
+        f.write(f"    {len(children)}, {len(entries)},\n")
+        f.write("    index_root, index_first_edge, index_edge_byte, index_edge_next, index_fail, index_match,\n")
+        f.write(f"    index_responses, {c_string(fallback)}\n")
+        f.write("};\n")
+
+    n_keywords = sum(len(keywords) for keywords, _ in entries)
+    print(f"Wrote {len(entries)} responses, {n_keywords} keywords, {len(children)} states to {output_file}")
+
+def main():
+    parser = argparse.ArgumentParser(description='Build the canned-response keyword index')
+    parser.add_argument('--input', default=os.path.join(SCRIPT_DIR, 'qa_responses.txt'),
+                        help='Keyword => response list')
+    parser.add_argument('--output', default=os.path.normpath(os.path.join(SCRIPT_DIR, '..', 'TinyLlama2_app', 'response_index_data.c')),
+                        help='Generated C file')
+    args = parser.parse_args()
+
+    entries, fallback = parse_responses(args.input)
+    generate_response_index_file(entries, fallback, args.output)
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,12 @@ import torch
 import numpy as np
 from transformers import LlamaForCausalLM, LlamaTokenizer
 import struct
+import argparse
+import heapq
+import json
+import os
+import re
+import zlib
 
 def extract_weights(model_path="TinyLlama/TinyLlama-1.1B-Chat-v1.0"):
     """Extract weights from TinyLlama2 model"""
@@ -40,6 +46,19 @@ def extract_weights(model_path="TinyLlama/TinyLlama-1.1B-Chat-v1.0"):
     weights['norm_final'] = model.model.norm.weight.detach().numpy()
     weights['output_proj'] = model.lm_head.weight.detach().numpy()
     
+    # Model dimensions for the blob header
+    cfg = model.config
+    weights['config'] = {
+        'dim': cfg.hidden_size,
+        'hidden_dim': cfg.intermediate_size,
+        'n_layers': cfg.num_hidden_layers,
+        'n_heads': cfg.num_attention_heads,
+        'n_kv_heads': cfg.num_key_value_heads,
+        'vocab_size': cfg.vocab_size,
+        'seq_len': cfg.max_position_embeddings,
+        'rope_theta': getattr(cfg, 'rope_theta', 10000.0),
+    }
+    
     return weights
 
 def quantize_weights(weights, bits=8):
@@ -65,6 +84,122 @@ def quantize_weights(weights, bits=8):
     
     return quantized
 
+def quantize_q8_rows(value):
+    """Symmetric int8 quantization with one scale per output row (W8A8 path)"""
+    rows = value.reshape(value.shape[0], -1)
+    max_abs = np.abs(rows).max(axis=1)
+    scale = np.where(max_abs > 0, max_abs / 127.0, 1.0).astype(np.float32)
+    q = np.clip(np.round(rows / scale[:, None]), -127, 127).astype(np.int8)
+    return q.reshape(value.shape), scale
+
+def kmeans_codebook(value, k, iters=20):
+    """1-D k-means over a tensor; returns uint8 indices and fp16 centroids (as uint16)"""
+    flat = value.astype(np.float32).ravel()
+    centroids = np.quantile(flat, (np.arange(k) + 0.5) / k).astype(np.float32)
+    for _ in range(iters):
+        # Centroids stay sorted, so nearest-centroid is a search over midpoints
+        idx = np.searchsorted((centroids[1:] + centroids[:-1]) / 2, flat)
+        counts = np.bincount(idx, minlength=k)
+        sums = np.bincount(idx, weights=flat, minlength=k)
+        centroids = np.where(counts > 0, sums / np.maximum(counts, 1), centroids).astype(np.float32)
+        centroids.sort()
+    idx = np.searchsorted((centroids[1:] + centroids[:-1]) / 2, flat).astype(np.uint8)
+    return idx.reshape(value.shape), centroids.astype(np.float16).view(np.uint16)
+
+def pack_nibbles(idx):
+    """Pack 4-bit indices two per byte, low nibble first"""
+    pairs = idx.reshape(-1, 2)
+    return (pairs[:, 0] | (pairs[:, 1] << 4)).astype(np.uint8)
+
+def quantize_ternary(value):
+    """Absmean ternary quantization: values in {-1, 0, +1} and one scale per tensor"""
+    scale = max(float(np.abs(value).mean()), 1e-8)
+    q = np.clip(np.round(value / scale), -1, 1).astype(np.int8)
+    return q, np.float32(scale)
+
+def pack_ternary(q):
+    """Pack each row as (plus, minus) uint32 bitmasks per 32 weights"""
+    rows, n = q.shape
+    assert n % 32 == 0, "ternary rows must be a multiple of 32 weights"
+    bits = (np.uint64(1) << np.arange(32, dtype=np.uint64))
+    groups = q.reshape(rows, n // 32, 32)
+    plus = ((groups == 1) * bits).sum(axis=2).astype(np.uint32)
+    minus = ((groups == -1) * bits).sum(axis=2).astype(np.uint32)
+    return np.stack([plus, minus], axis=2).reshape(rows, -1)
+
+def factor_lowrank(value, rank):
+    """Truncated SVD: value (d, n) ~= u (d, rank) @ v (rank, n)"""
+    u, s, vt = np.linalg.svd(value.astype(np.float32), full_matrices=False)
+    root = np.sqrt(s[:rank])
+    return (u[:, :rank] * root).astype(np.float32), (root[:, None] * vt[:rank]).astype(np.float32)
+
+HUFFMAN_MAX_BITS = 11  # must match quant.h
+
+def huffman_code_lengths(freqs, max_bits=HUFFMAN_MAX_BITS):
+    """Huffman code length per symbol, limited to max_bits by flattening the counts"""
+    freqs = np.asarray(freqs, dtype=np.int64)
+    while True:
+        used = np.flatnonzero(freqs)
+        lengths = np.zeros(len(freqs), dtype=np.uint8)
+        if len(used) == 1:
+            lengths[used] = 1
+            return lengths
+        heap = [(int(freqs[s]), i, [int(s)]) for i, s in enumerate(used)]
+        heapq.heapify(heap)
+        tie = len(heap)
+        while len(heap) > 1:
+            f1, _, s1 = heapq.heappop(heap)
+            f2, _, s2 = heapq.heappop(heap)
+            for s in s1 + s2:
+                lengths[s] += 1
+            heapq.heappush(heap, (f1 + f2, tie, s1 + s2))
+            tie += 1
+        if lengths.max() <= max_bits:
+            return lengths
+        freqs = np.where(freqs > 0, (freqs + 1) // 2, 0)
+
+def canonical_codes(lengths, max_bits=HUFFMAN_MAX_BITS):
+    """Canonical codes as in DEFLATE, matching build_huffman_lut() in quant.c"""
+    count = np.bincount(lengths, minlength=max_bits + 1)
+    count[0] = 0
+    next_code = [0] * (max_bits + 1)
+    code = 0
+    for bits in range(1, max_bits + 1):
+        code = (code + int(count[bits - 1])) << 1
+        next_code[bits] = code
+    codes = np.zeros(len(lengths), dtype=np.uint32)
+    for sym, bits in enumerate(lengths):
+        if bits:
+            codes[sym] = next_code[bits]
+            next_code[bits] += 1
+    return codes
+
+def huffman_encode(symbols, lengths):
+    """MSB-first bitstream of uint8 symbols"""
+    codes = canonical_codes(lengths)
+    sym_len = lengths[symbols].astype(np.int64)
+    # Left-align every code in 16 bits, then keep the first len bits of each
+    aligned = (codes[symbols] << (16 - sym_len)).astype('>u2')
+    bits = np.unpackbits(aligned.view(np.uint8)).reshape(-1, 16)
+    keep = np.arange(16)[None, :] < sym_len[:, None]
+    return np.packbits(bits[keep]).tobytes()
+
+def encode_q8_huffman(tensors):
+    """Per layer: int8 rows Huffman-coded with their own code table, layers padded to one stride"""
+    streams, tables, scales = [], [], []
+    for t in tensors:
+        q, scale = quantize_q8_rows(t)
+        symbols = q.view(np.uint8).ravel()
+        lengths = huffman_code_lengths(np.bincount(symbols, minlength=256))
+        streams.append(huffman_encode(symbols, lengths))
+        tables.append(lengths)
+        scales.append(scale)
+    stride = (max(len(s) for s in streams) + 3) & ~3
+    data = np.zeros((len(streams), stride), dtype=np.uint8)
+    for i, s in enumerate(streams):
+        data[i, :len(s)] = np.frombuffer(s, dtype=np.uint8)
+    return {'data': data, 'scale': np.stack(scales), 'codebook': np.stack(tables)}
+
 def generate_c_array(name, data, data_type="float"):
     """Generate C array declaration"""
     if data_type == "float":
@@ -81,9 +216,9 @@ def generate_c_array(name, data, data_type="float"):
         if len(flat_data) % 8 != 0:
             array_str += "\n"
         array_str += "};\n\n"
-    else:  # uint8 quantized
+    else:  # uint8 / int8 quantized
         flat_data = data.flatten()
-        array_str = "const uint8_t " + name + "[] = {\n"
+        array_str = f"const {data_type}_t " + name + "[] = {\n"
         for i, val in enumerate(flat_data):
             if i % 16 == 0:
                 array_str += "    "
@@ -98,6 +233,10 @@ def generate_c_array(name, data, data_type="float"):
     
     return array_str
 
+PROJECTIONS = ['wq', 'wk', 'wv', 'wo', 'w1', 'w2', 'w3']
+
+LOWRANK_PROJECTIONS = ['wo', 'w2']
+
 def generate_weight_file(weights, output_file="real_model_weights.c", use_quantization=True):
     """Generate C file with all model weights"""
     
@@ -145,30 +284,344 @@ def generate_weight_file(weights, output_file="real_model_weights.c", use_quanti
             f.write("    // TODO: Load remaining weights\n")
         f.write("}\n\n")
 
+# Model blob layout, must match model_blob.h
+BLOB_MAGIC = 0x324C4C54  # "TLL2"
+BLOB_VERSION = 1
+BLOB_ALIGN = 16
+BLOB_TENSORS = ['token_embedding', 'rms_att', 'rms_ffn', 'wq', 'wk', 'wv', 'wo',
+                'w1', 'w2', 'w3', 'rms_final', 'wcls']
+BLOB_PARTS = ['data', 'scale', 'codebook', 'lowrank_u', 'lowrank_v']
+BLOB_HEADER_FORMAT = '<3I9iIf2I'
+BLOB_HEADER_SIZE = struct.calcsize(BLOB_HEADER_FORMAT) + len(BLOB_TENSORS) * len(BLOB_PARTS) * 8
+
+# WEIGHT_FORMAT_* values from tinyllama2.h
+WEIGHT_FORMATS = {'f32': 0, 'q8': 1, 'cb4': 2, 'cb8': 3, 'ternary': 4, 'q8huff': 5}
+
+def encode_tensor(tensors, weight_format):
+    """Encode the per-layer matrices of one tensor; returns {part: array}"""
+    if weight_format == 'f32':
+        return {'data': np.stack(tensors).astype(np.float32)}
+    if weight_format == 'q8':
+        coded = [quantize_q8_rows(t) for t in tensors]
+        return {'data': np.stack([q for q, _ in coded]), 'scale': np.stack([s for _, s in coded])}
+    if weight_format in ('cb4', 'cb8'):
+        bits = 4 if weight_format == 'cb4' else 8
+        coded = [kmeans_codebook(t, 1 << bits) for t in tensors]
+        idx = np.stack([i for i, _ in coded])
+        return {'data': pack_nibbles(idx) if bits == 4 else idx,
+                'codebook': np.stack([c for _, c in coded])}
+    if weight_format == 'q8huff':
+        return encode_q8_huffman(tensors)
+    if weight_format == 'ternary':
+        coded = [quantize_ternary(t) for t in tensors]
+        return {'data': np.stack([pack_ternary(q) for q, _ in coded]),
+                'scale': np.array([s for _, s in coded], dtype=np.float32)}
+    raise ValueError(f"unknown weight format {weight_format}")
+
+def build_model_blob(weights, weight_format='f32', lowrank_rank=0, shared_classifier=False):
+    """Lay out header, tensor offset table and aligned tensor data in one blob"""
+    layers = weights['layers']
+    parts = {name: {} for name in BLOB_TENSORS}
+    stack = lambda key: np.stack([layer[key] for layer in layers]).astype(np.float32)
+
+    parts['rms_att']['data'] = stack('attention_norm')
+    parts['rms_ffn']['data'] = stack('ffn_norm')
+    parts['rms_final']['data'] = weights['norm_final'].astype(np.float32)
+
+    # Only the codebook formats compress the embedding, the others keep it fp32
+    embedding = weights['token_embedding_table']
+    parts['token_embedding'] = encode_tensor([embedding], weight_format if weight_format in ('cb4', 'cb8') else 'f32')
+
+    projections = [(name, [layer[name] for layer in layers]) for name in PROJECTIONS]
+    if not shared_classifier:
+        projections.append(('wcls', [weights['output_proj']]))
+    for name, tensors in projections:
+        if lowrank_rank > 0 and name in LOWRANK_PROJECTIONS + ['wcls']:
+            factors = [factor_lowrank(t, lowrank_rank) for t in tensors]
+            parts[name]['lowrank_u'] = np.stack([u for u, _ in factors])
+            parts[name]['lowrank_v'] = np.stack([v for _, v in factors])
+        else:
+            parts[name] = encode_tensor(tensors, weight_format)
+
+    blob = bytearray(BLOB_HEADER_SIZE)
+    table = []
+    for name in BLOB_TENSORS:
+        for part in BLOB_PARTS:
+            arr = parts[name].get(part)
+            if arr is None:
+                table += [0, 0]
+                continue
+            blob += bytes(-len(blob) % BLOB_ALIGN)
+            table += [len(blob), arr.nbytes]
+            blob += np.ascontiguousarray(arr).tobytes()
+    blob += bytes(-len(blob) % BLOB_ALIGN)
+
+    # The checksum of the tensor data goes into the header, so anything
+    # keyed on the header (KV snapshots) also changes with the weights
+    cfg = weights['config']
+    checksum = zlib.crc32(bytes(blob[BLOB_HEADER_SIZE:]))
+    header = struct.pack(BLOB_HEADER_FORMAT, BLOB_MAGIC, BLOB_VERSION, len(blob),
+                         cfg['dim'], cfg['hidden_dim'], cfg['n_layers'], cfg['n_heads'],
+                         cfg['n_kv_heads'], cfg['vocab_size'], cfg['seq_len'],
+                         WEIGHT_FORMATS[weight_format], lowrank_rank, checksum,
+                         cfg.get('rope_theta', 10000.0), 0, 0)
+    header += struct.pack(f'<{len(table)}I', *table)
+    blob[:BLOB_HEADER_SIZE] = header
+    return bytes(blob)
+
+def generate_blob_file(blob, output_file="model_weights.c"):
+    """Emit the blob as a C file that replaces the placeholder model_weights.c"""
+    with open(output_file, 'w') as f:
+        f.write("// TinyLlama2 model blob\n")
+        f.write("// Generated automatically by scripts/extract_weights.py\n\n")
+        f.write("#include \"model_blob.h\"\n\n")
+        f.write(f"static const uint8_t model_blob_data[{len(blob)}] MODEL_BLOB_SECTION = {{\n")
+        for i in range(0, len(blob), 16):
+            f.write("    " + ", ".join(f"0x{b:02x}" for b in blob[i:i + 16]) + ",\n")
+        f.write("};\n\n")
+        f.write("const uint8_t* const model_blob = model_blob_data;\n")
+
+def extract_tokenizer(model_path="TinyLlama/TinyLlama-1.1B-Chat-v1.0"):
+    """SentencePiece vocabulary as (piece bytes, score) per token id, llama2.c style"""
+    sp = LlamaTokenizer.from_pretrained(model_path).sp_model
+    tokens = []
+    for i in range(sp.get_piece_size()):
+        piece = sp.id_to_piece(i)
+        if i == sp.bos_id():
+            piece = '\n<s>\n'
+        elif i == sp.eos_id():
+            piece = '\n</s>\n'
+        tokens.append((piece.replace('\u2581', ' ').encode('utf-8'), sp.get_score(i)))
+    return tokens
+
+def piece_hash(seed, piece):
+    """Seeded FNV-1a, must match piece_hash() in tokenizer.c"""
+    h = 2166136261 ^ seed
+    for byte in piece:
+        h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+def build_perfect_hash(tokens, load_factor=4):
+    """Minimal perfect hash over the distinct pieces (hash and displace).
+    Returns (seeds, ids): per bucket 0 (empty), -(slot + 1) for one piece or
+    a seed placing its pieces in free slots; ids maps slots to token ids."""
+    first_id = {}
+    for i, (piece, _) in enumerate(tokens):
+        first_id.setdefault(piece, i)  # duplicate pieces resolve to the lowest id
+    n_slots = len(first_id)
+    n_buckets = max(1, n_slots // load_factor)
+    buckets = [[] for _ in range(n_buckets)]
+    for piece in first_id:
+        buckets[piece_hash(0, piece) % n_buckets].append(piece)
+
+    seeds = [0] * n_buckets
+    ids = [-1] * n_slots
+    # Largest buckets first, while most slots are still free
+    order = sorted(range(n_buckets), key=lambda b: -len(buckets[b]))
+    singles = []
+    for b in order:
+        if len(buckets[b]) <= 1:
+            if buckets[b]:
+                singles.append(b)
+            continue
+        seed = 1
+        while True:
+            slots = [piece_hash(seed, piece) % n_slots for piece in buckets[b]]
+            if len(set(slots)) == len(slots) and all(ids[s] < 0 for s in slots):
+                break
+            seed += 1
+        seeds[b] = seed
+        for slot, piece in zip(slots, buckets[b]):
+            ids[slot] = first_id[piece]
+    # Single pieces take the remaining slots directly
+    free = [s for s in range(n_slots) if ids[s] < 0]
+    for b, slot in zip(singles, free):
+        seeds[b] = -(slot + 1)
+        ids[slot] = first_id[buckets[b][0]]
+    return seeds, ids
+
+# Tokenizer blob layout, must match tokenizer.h
+TOKENIZER_MAGIC = 0x4B544C54  # "TLTK"
+TOKENIZER_VERSION = 2
+TOKENIZER_HEADER_FORMAT = '<3I2i4I'
+
+def build_tokenizer_blob(tokens):
+    """Packed tokenizer read in place by build_tokenizer(): header, scores,
+    piece offsets, perfect hash tables, then the NUL-terminated pieces"""
+    seeds, ids = build_perfect_hash(tokens)
+    offsets = [0]
+    pool = bytearray()
+    for piece, _ in tokens:
+        pool += piece + b'\0'
+        offsets.append(len(pool))
+    tables = (np.array([score for _, score in tokens], dtype=np.float32).tobytes() +
+              np.array(offsets, dtype=np.uint32).tobytes() +
+              np.array(seeds, dtype=np.int32).tobytes() +
+              np.array(ids, dtype=np.int32).tobytes())
+    total_size = struct.calcsize(TOKENIZER_HEADER_FORMAT) + len(tables) + len(pool)
+    # Checksum of the tables and pieces, the vocabulary's fingerprint for
+    # build-time token caches
+    checksum = zlib.crc32(tables + bytes(pool))
+    header = struct.pack(TOKENIZER_HEADER_FORMAT, TOKENIZER_MAGIC, TOKENIZER_VERSION, total_size,
+                         len(tokens), max(len(piece) for piece, _ in tokens), len(pool),
+                         len(seeds), len(ids), checksum)
+    return header + tables + bytes(pool)
+
+def generate_tokenizer_file(blob, output_file="tokenizer_data.c"):
+    """Emit the tokenizer blob as a C file that replaces the placeholder tokenizer_data.c"""
+    with open(output_file, 'w') as f:
+        f.write("// TinyLlama2 tokenizer vocabulary\n")
+        f.write("// Generated automatically by scripts/extract_weights.py\n\n")
+        f.write("#include \"tokenizer.h\"\n\n")
+        f.write(f"static const uint8_t tokenizer_data[{len(blob)}] __attribute__((aligned(4))) = {{\n")
+        for i in range(0, len(blob), 16):
+            f.write("    " + ", ".join(f"0x{b:02x}" for b in blob[i:i + 16]) + ",\n")
+        f.write("};\n\n")
+        f.write("const uint8_t* const tokenizer_blob = tokenizer_data;\n")
+        f.write(f"const uint32_t tokenizer_blob_size = {len(blob)};\n")
+
+# LoRA adapter blob layout, must match lora.h
+LORA_MAGIC = 0x414C4C54  # "TLLA"
+LORA_VERSION = 1
+LORA_NAME_LEN = 16
+LORA_TARGETS = ['wq', 'wk', 'wv', 'wo', 'w1', 'w2', 'w3']
+LORA_HEADER_FORMAT = f'<3I2if{LORA_NAME_LEN}s'
+LORA_HEADER_SIZE = struct.calcsize(LORA_HEADER_FORMAT) + 2 * len(LORA_TARGETS) * 8
+
+# PEFT module names of the adapted projections
+LORA_MODULES = {'q_proj': 'wq', 'k_proj': 'wk', 'v_proj': 'wv', 'o_proj': 'wo',
+                'gate_proj': 'w1', 'down_proj': 'w2', 'up_proj': 'w3'}
+
+def extract_lora(adapter_path):
+    """Load a PEFT LoRA adapter directory: per-layer {target: {'A': (r, n), 'B': (d, r)}}"""
+    with open(os.path.join(adapter_path, 'adapter_config.json')) as f:
+        cfg = json.load(f)
+    safetensors_path = os.path.join(adapter_path, 'adapter_model.safetensors')
+    if os.path.exists(safetensors_path):
+        from safetensors.numpy import load_file
+        state = load_file(safetensors_path)
+    else:
+        state = torch.load(os.path.join(adapter_path, 'adapter_model.bin'), map_location='cpu')
+        state = {key: value.float().numpy() for key, value in state.items()}
+
+    layers = {}
+    for key, value in state.items():
+        m = re.search(r'layers\.(\d+)\..*\.(\w+_proj)\.lora_([AB])\.', key)
+        if m and m.group(2) in LORA_MODULES:
+            target = layers.setdefault(int(m.group(1)), {}).setdefault(LORA_MODULES[m.group(2)], {})
+            target[m.group(3)] = value
+    return {
+        'name': os.path.basename(os.path.normpath(adapter_path)),
+        'rank': cfg['r'],
+        'scale': cfg['lora_alpha'] / cfg['r'],
+        'layers': layers,
+    }
+
+def build_lora_blob(lora, n_layers):
+    """Lay out header, A/B offset tables and aligned factor data of one adapter"""
+    blob = bytearray(LORA_HEADER_SIZE)
+    a_table, b_table = [], []
+    for target in LORA_TARGETS:
+        factors = [lora['layers'].get(i, {}).get(target) for i in range(n_layers)]
+        present = [f for f in factors if f]
+        if not present:
+            a_table += [0, 0]
+            b_table += [0, 0]
+            continue
+        # Layers without this projection get zero factors
+        a = np.stack([f['A'] if f else np.zeros_like(present[0]['A']) for f in factors]).astype(np.float32)
+        b = np.stack([f['B'] if f else np.zeros_like(present[0]['B']) for f in factors]).astype(np.float32)
+        for arr, table in ((a, a_table), (b, b_table)):
+            blob += bytes(-len(blob) % BLOB_ALIGN)
+            table += [len(blob), arr.nbytes]
+            blob += np.ascontiguousarray(arr).tobytes()
+    blob += bytes(-len(blob) % BLOB_ALIGN)
+
+    name = lora['name'].encode()[:LORA_NAME_LEN - 1]
+    header = struct.pack(LORA_HEADER_FORMAT, LORA_MAGIC, LORA_VERSION, len(blob),
+                         n_layers, lora['rank'], lora['scale'], name)
+    header += struct.pack(f'<{len(a_table) + len(b_table)}I', *(a_table + b_table))
+    blob[:LORA_HEADER_SIZE] = header
+    return bytes(blob)
+
+def generate_lora_file(blobs, output_file="lora_adapters.c"):
+    """Emit the adapter blobs as a C file that replaces the placeholder lora_adapters.c"""
+    with open(output_file, 'w') as f:
+        f.write("// TinyLlama2 LoRA adapters\n")
+        f.write("// Generated automatically by scripts/extract_weights.py\n\n")
+        f.write("#include \"lora.h\"\n\n")
+        for i, blob in enumerate(blobs):
+            f.write(f"static const uint8_t lora_adapter_{i}[{len(blob)}] __attribute__((aligned(MODEL_BLOB_ALIGN))) = {{\n")
+            for j in range(0, len(blob), 16):
+                f.write("    " + ", ".join(f"0x{b:02x}" for b in blob[j:j + 16]) + ",\n")
+            f.write("};\n\n")
+        names = ", ".join(f"lora_adapter_{i}" for i in range(len(blobs)))
+        f.write(f"const uint8_t* const lora_adapter_blobs[] = {{ {names} }};\n")
+        f.write(f"const int lora_adapter_count = {len(blobs)};\n")
+
 def main():
+    parser = argparse.ArgumentParser(description="TinyLlama2 Weight Extraction Tool")
+    parser.add_argument("--model", default="TinyLlama/TinyLlama-1.1B-Chat-v1.0")
+    parser.add_argument("--format", choices=sorted(WEIGHT_FORMATS), default="f32",
+                        help="weight format of the projection matrices")
+    parser.add_argument("--lowrank-rank", type=int, default=0,
+                        help="factor wo/w2/wcls into U @ V with this rank (0 = dense)")
+    parser.add_argument("--shared-classifier", action="store_true",
+                        help="omit wcls and reuse the token embedding")
+    parser.add_argument("--output", default="model_weights.c")
+    parser.add_argument("--bin", default="model.bin", help="raw blob for host builds")
+    parser.add_argument("--tokenizer-output", default="tokenizer_data.c")
+    parser.add_argument("--tokenizer-bin", default="tokenizer.bin", help="tokenizer blob for host builds")
+    parser.add_argument("--lora", action="append", default=[], metavar="ADAPTER_DIR",
+                        help="PEFT LoRA adapter to link in, named after its directory (repeatable)")
+    parser.add_argument("--lora-output", default="lora_adapters.c")
+    parser.add_argument("--arrays", action="store_true",
+                        help="also emit per-tensor C arrays (real_model_weights.c)")
+    args = parser.parse_args()
+
     print("TinyLlama2 Weight Extraction Tool")
     print("=================================")
     
     # Extract weights
-    weights = extract_weights()
+    weights = extract_weights(args.model)
     print(f"Extracted weights from {len(weights['layers'])} layers")
     
     # Print weight sizes
     token_emb_size = weights['token_embedding_table'].nbytes / (1024*1024)
     print(f"Token embedding size: {token_emb_size:.2f} MB")
     
-    # Generate C file
-    generate_weight_file(weights, use_quantization=True)
-    print("Generated real_model_weights.c with quantized weights")
+    # Generate the model blob
+    blob = build_model_blob(weights, args.format, args.lowrank_rank, args.shared_classifier)
+    generate_blob_file(blob, args.output)
+    with open(args.bin, 'wb') as f:
+        f.write(blob)
+    print(f"Generated {args.output} and {args.bin}: {len(blob) / (1024*1024):.2f} MB {args.format} blob")
+    
+    # Vocabulary for the on-device BPE encoder
+    tokens = extract_tokenizer(args.model)
+    tokenizer_blob = build_tokenizer_blob(tokens)
+    generate_tokenizer_file(tokenizer_blob, args.tokenizer_output)
+    with open(args.tokenizer_bin, 'wb') as f:
+        f.write(tokenizer_blob)
+    print(f"Generated {args.tokenizer_output} and {args.tokenizer_bin}: {len(tokens)} tokens, "
+          f"{len(tokenizer_blob) / 1024:.1f} KB")
+    
+    if args.lora:
+        n_layers = weights['config']['n_layers']
+        adapters = [extract_lora(path) for path in args.lora]
+        blobs = [build_lora_blob(lora, n_layers) for lora in adapters]
+        generate_lora_file(blobs, args.lora_output)
+        for lora, blob in zip(adapters, blobs):
+            print(f"LoRA adapter {lora['name']}: rank {lora['rank']}, {len(blob) / 1024:.1f} KB")
+        print(f"Generated {args.lora_output}")
     
-    # Generate header with dimensions
-    with open("real_model_config.h", 'w') as f:
-        f.write("// Real model configuration\n")
-        f.write(f"#define REAL_VOCAB_SIZE {weights['token_embedding_table'].shape[0]}\n")
-        f.write(f"#define REAL_MODEL_DIM {weights['token_embedding_table'].shape[1]}\n")
-        f.write(f"#define REAL_N_LAYERS {len(weights['layers'])}\n")
+    if args.arrays:
+        generate_weight_file(weights, use_quantization=True)
+        print("Generated real_model_weights.c with quantized weights")
     
-    print("Generated real_model_config.h with actual dimensions")
+    cfg = weights['config']
+    print(f"Model config in blob header: dim={cfg['dim']} hidden_dim={cfg['hidden_dim']} "
+          f"layers={cfg['n_layers']} heads={cfg['n_heads']}/{cfg['n_kv_heads']} vocab={cfg['vocab_size']}")
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+TinyLlama2 Memory Placement Report
+Lists which symbols of the built ELF landed in ITCM, DTCM, SRAM and ROM
+"""
+
+import re
+import subprocess
+import sys
+
+DEFAULT_ELF = "out/TinyLlama2_app/SSE-320-FVP/Debug/TinyLlama2_app.elf"
+REGIONS_HEADER = "TinyLlama2_app/RTE/Device/SSE-320-FVP/regions_SSE-320.h"
+
+REGION_NAMES = {
+    "ROM0": "ROM0 (boot ROM)",
+    "ROM1": "ROM1 (SRAM_S)",
+    "ROM2": "ROM2 (SRAM_NS)",
+    "RAM0": "RAM0 (ISRAM)",
+    "RAM1": "RAM1 (ITCM)",
+    "RAM2": "RAM2 (DTCM)",
+    "RAM3": "RAM3 (QSPI SRAM)",
+}
+
+def read_regions(header=REGIONS_HEADER):
+    """Parse __<REGION>_BASE / __<REGION>_SIZE from the regions header"""
+    values = {}
+    with open(header) as f:
+        for line in f:
+            m = re.match(r"#define __(\w+)_(BASE|SIZE)\s+(0x[0-9A-Fa-f]+)", line)
+            if m:
+                values.setdefault(m.group(1), {})[m.group(2)] = int(m.group(3), 16)
+    return {name: (v["BASE"], v["SIZE"]) for name, v in values.items()
+            if "BASE" in v and v.get("SIZE", 0) > 0}
+
+def read_symbols(elf, nm="arm-none-eabi-nm"):
+    """Return (address, size, type, name) for every sized symbol"""
+    out = subprocess.run([nm, "-S", "-n", "-C", elf], capture_output=True, text=True, check=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 4:
+            symbols.append((int(parts[0], 16), int(parts[1], 16), parts[2], parts[3]))
+    return symbols
+
+def main():
+    elf = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_ELF
+    regions = read_regions()
+    symbols = read_symbols(elf)
+
+    print("TinyLlama2 Memory Placement Report")
+    print("==================================")
+    for name, (base, size) in sorted(regions.items(), key=lambda r: r[1][0]):
+        placed = [s for s in symbols if base <= s[0] < base + size]
+        used = sum(s[1] for s in placed)
+        print(f"\n{REGION_NAMES.get(name, name)} @ 0x{base:08X}: {used} / {size} bytes")
+        # TCM contents are listed in full, the big regions only by largest symbols
+        limit = None if name in ("RAM1", "RAM2") else 10
+        for addr, sym_size, kind, sym in sorted(placed, key=lambda s: -s[1])[:limit]:
+            print(f"  0x{addr:08X} {sym_size:8d}  {kind}  {sym}")
+
+if __name__ == "__main__":
+    main()